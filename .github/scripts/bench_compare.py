@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+# Compares benchmark results (the BENCH_OUTPUT json written by native
+# headless runs) against the stored baseline for that game. Several result
+# files from repeated runs are reduced to the median of each value first, so
+# one noisy run on a shared runner does not decide the outcome. A metric
+# fails when it is both more than the relative threshold and more than its
+# absolute slack above the baseline. A missing baseline fails as well, the
+# medians are printed (and written with --output) so they can be committed
+# as the baseline.
+#
+# usage: bench_compare.py <result.json> [<result.json> ...] <baseline.json>
+#                         [--threshold 0.5] [--output median.json] [--update]
+
+import argparse
+import json
+import os
+import statistics
+import sys
+
+# (section, key, absolute slack), the slack keeps tiny timings from failing on
+# a few microseconds of scheduler noise
+METRICS = [
+    ('update', 'avg_us', 20.0),
+    ('update', 'p95_us', 50.0),
+    ('draw', 'avg_us', 100.0),
+    ('draw', 'p95_us', 250.0),
+    ('init', 'avg_us', 5000.0),
+    ('peak_rss_kb', None, 4096.0),
+]
+
+
+def metric(data, section, key):
+    value = data.get(section)
+    if key is not None:
+        value = value.get(key) if isinstance(value, dict) else None
+    return value
+
+
+def median_result(results):
+    # median of every number, the structure of the first result is kept
+    def merge(values):
+        first = values[0]
+        if isinstance(first, dict):
+            return {k: merge([v[k] for v in values if isinstance(v, dict) and k in v]) for k in first}
+        if isinstance(first, (int, float)) and not isinstance(first, bool):
+            m = statistics.median(values)
+            return int(m) if all(isinstance(v, int) for v in values) else m
+        return first
+    return merge(results)
+
+
+def error(message):
+    # shows up as an annotation on the workflow run
+    if os.environ.get('GITHUB_ACTIONS'):
+        print('::error::%s' % message)
+    else:
+        print('error: %s' % message)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('files', nargs='+', metavar='file',
+                        help='result json files followed by the baseline json')
+    parser.add_argument('--threshold', type=float, default=0.5,
+                        help='allowed relative regression (default 0.5)')
+    parser.add_argument('--output',
+                        help='write the median result to this file')
+    parser.add_argument('--update', action='store_true',
+                        help='write the median result as the new baseline')
+    args = parser.parse_args()
+    if len(args.files) < 2:
+        parser.error('need at least one result and the baseline')
+    results, baseline_file = args.files[:-1], args.files[-1]
+
+    data = []
+    for name in results:
+        with open(name) as f:
+            data.append(json.load(f))
+    result = median_result(data)
+
+    if args.output:
+        with open(args.output, 'w', newline='\n') as f:
+            json.dump(result, f, indent=2)
+            f.write('\n')
+
+    if args.update:
+        with open(baseline_file, 'w', newline='\n') as f:
+            json.dump(result, f, indent=2)
+            f.write('\n')
+        print('baseline written to %s (median of %d runs)' % (baseline_file, len(data)))
+        return 0
+
+    if not os.path.isfile(baseline_file):
+        error('no baseline at %s, commit the medians below as the baseline' % baseline_file)
+        print(json.dumps(result, indent=2))
+        return 1
+
+    with open(baseline_file) as f:
+        baseline = json.load(f)
+
+    failed = False
+    for section, key, slack in METRICS:
+        name = section if key is None else '%s.%s' % (section, key)
+        new = metric(result, section, key)
+        old = metric(baseline, section, key)
+        if new is None or old is None:
+            continue
+        change = (new - old) / old if old else 0.0
+        status = 'ok'
+        if change > args.threshold and new - old > slack:
+            status = 'REGRESSION'
+            failed = True
+        print('%-16s %12.3f -> %12.3f  %+7.1f%%  %s' % (name, old, new, change * 100.0, status))
+
+    if failed:
+        print('regression above %.0f%% threshold (median of %d runs)' % (args.threshold * 100.0, len(data)))
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
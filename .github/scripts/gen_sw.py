@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+# Generates the offline service worker (sw.js) for one or more game output
+# directories. Every file the game needs is listed with a hash of its content,
+# so a rebuilt game gets a new cache and the old one is thrown away.
+#
+# usage: gen_sw.py <game dir> [<game dir> ...]
+
+import hashlib
+import json
+import os
+import re
+import sys
+
+PRECACHE_FILES = ['index.html', 'game.js', 'game.wasm', 'game.pak', 'game.data']
+
+# the page loads game.pak (see pack_data.py) when it exists, game.data is then
+# only the fallback for browsers without DecompressionStream and not precached
+REPLACED_BY = {'game.data': 'game.pak'}
+
+SW_TEMPLATE = """// generated by gen_sw.py, do not edit
+const GAME = %(game)s;
+const VERSION = %(version)s;
+const PRECACHE = %(files)s;
+const CACHE = GAME + '-' + VERSION;
+// how long index.html may take from the network before the cached copy is used
+const NETWORK_TIMEOUT = 3000;
+
+function precacheKey(name) {
+    return new URL(name + '?v=' + PRECACHE[name], self.registration.scope).href;
+}
+
+function precacheName(request) {
+    const url = new URL(request.url);
+    if (url.origin !== self.location.origin || !url.href.startsWith(self.registration.scope))
+        return null;
+    let name = url.pathname.substring(new URL(self.registration.scope).pathname.length);
+    if (name === '')
+        name = 'index.html';
+    return Object.prototype.hasOwnProperty.call(PRECACHE, name) ? name : null;
+}
+
+self.addEventListener('install', (event) => {
+    event.waitUntil((async () => {
+        const cache = await caches.open(CACHE);
+        for (const name of Object.keys(PRECACHE)) {
+            const key = precacheKey(name);
+            if (await cache.match(key))
+                continue;
+            // the page registers the worker once the game runs, so these are
+            // in the http cache already, revalidating them costs a 304 instead
+            // of a second download while still giving the current file
+            const response = await fetch(new Request(name, {cache: 'no-cache'}));
+            if (!response.ok)
+                throw new Error(name + ': ' + response.status);
+            await cache.put(key, response);
+        }
+        await self.skipWaiting();
+    })());
+});
+
+self.addEventListener('activate', (event) => {
+    event.waitUntil((async () => {
+        for (const key of await caches.keys()) {
+            if (key.startsWith(GAME + '-') && key !== CACHE)
+                await caches.delete(key);
+        }
+        await self.clients.claim();
+    })());
+});
+
+self.addEventListener('fetch', (event) => {
+    if (event.request.method !== 'GET')
+        return;
+    const name = precacheName(event.request);
+    if (name === null)
+        return;
+    event.respondWith((async () => {
+        const cache = await caches.open(CACHE);
+        if (name === 'index.html') {
+            // page itself is network first so a new build is picked up when
+            // online, a slow network gives up after NETWORK_TIMEOUT when there
+            // is a cached copy to fall back to
+            const cached = await cache.match(precacheKey(name));
+            const controller = new AbortController();
+            const timer = cached ? setTimeout(() => controller.abort(), NETWORK_TIMEOUT) : null;
+            try {
+                // navigation requests cannot be copied with a signal, fetch the url
+                const response = await fetch(event.request.url, {signal: controller.signal});
+                if (response.ok)
+                    return response;
+            } catch (e) {
+            } finally {
+                clearTimeout(timer);
+            }
+            return cached || Response.error();
+        }
+        // the stored response keeps its original headers (application/wasm),
+        // so instantiateStreaming still compiles game.wasm while it is read
+        const cached = await cache.match(precacheKey(name));
+        if (cached)
+            return cached;
+        const response = await fetch(event.request);
+        if (response.ok)
+            await cache.put(precacheKey(name), response.clone());
+        return response;
+    })());
+});
+"""
+
+
+def file_hash(path):
+    h = hashlib.sha256()
+    with open(path, 'rb') as f:
+        for chunk in iter(lambda: f.read(1 << 16), b''):
+            h.update(chunk)
+    return h.hexdigest()[:16]
+
+
+def referenced_files(game_dir):
+    """files game.js loads next to itself: locateFile('game.wasm') and the
+    data package. Without them the cached game cannot start offline"""
+    with open(os.path.join(game_dir, 'game.js'), encoding='utf-8', errors='replace') as f:
+        js = f.read()
+    names = set(re.findall(r"locateFile\('([^']+)'\)", js))
+    names.update(re.findall(r"REMOTE_PACKAGE_BASE\s*=\s*'([^']+)'", js))
+    return sorted(names)
+
+
+def generate(game_dir, game):
+    if not os.path.isfile(os.path.join(game_dir, 'game.js')):
+        sys.exit('%s: no game.js found' % game_dir)
+    missing = [name for name in referenced_files(game_dir)
+               if not os.path.isfile(os.path.join(game_dir, name))]
+    if missing:
+        sys.exit('%s: game.js loads %s, not found (incomplete build?)' % (game_dir, ', '.join(missing)))
+
+    files = {}
+    for name in PRECACHE_FILES:
+        path = os.path.join(game_dir, name)
+        if name in REPLACED_BY and os.path.isfile(os.path.join(game_dir, REPLACED_BY[name])):
+            continue
+        if os.path.isfile(path):
+            files[name] = file_hash(path)
+
+    version = hashlib.sha256(json.dumps(files, sort_keys=True).encode()).hexdigest()[:16]
+    with open(os.path.join(game_dir, 'sw.js'), 'w', newline='\n') as f:
+        f.write(SW_TEMPLATE % {
+            'game': json.dumps(game),
+            'version': json.dumps(version),
+            'files': json.dumps(files, indent=4),
+        })
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        sys.exit('usage: gen_sw.py <game dir> [<game dir> ...]')
+    for game_dir in sys.argv[1:]:
+        game = os.environ.get('GAME_NAME') or os.path.basename(os.path.normpath(game_dir))
+        generate(game_dir, game)
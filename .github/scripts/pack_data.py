@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+# Builds game.pak, a compressed copy of the emscripten game.data package, for
+# one or more game output directories. The file list comes from the
+# loadPackage() metadata in game.js. Each file is stored raw or as raw deflate
+# depending on its type. The page (index.html) downloads game.pak, inflating
+# each entry as its bytes arrive, and starts game.js only once the whole
+# game.data is rebuilt: emscripten's loadPackage takes the package in one piece
+# through Module.getPreloadedPackage, so files cannot be handed over one by
+# one. game.data itself is left in place as fallback.
+#
+# game.pak layout (little endian):
+#   'PAK1', entry count (u32), unpacked size (u32)
+#   per entry: offset in game.data (u32), size (u32), stored size (u32), method (u8)
+#   entry data in the same order, method 0 = raw, 1 = deflate-raw
+#
+# usage: pack_data.py <game dir> [<game dir> ...]
+
+import json
+import os
+import re
+import struct
+import sys
+import zlib
+
+# already compressed formats are stored as is, inflating them in the page
+# would cost more time than the few bytes saved
+RAW_TYPES = ('.ogg', '.mp3', '.wasm')
+
+# smallest saving (as a fraction of the file) worth a deflate entry
+MIN_SAVING = 1.0 / 16
+
+
+def package_files(game_js):
+    with open(game_js, encoding='utf-8') as f:
+        m = re.search(r'loadPackage\((\{"files".*?\})\);', f.read(), re.S)
+    if not m:
+        return None
+    metadata = json.loads(m.group(1))
+    return metadata['files'], metadata['remote_package_size']
+
+
+def deflate(data):
+    c = zlib.compressobj(9, zlib.DEFLATED, -15)
+    return c.compress(data) + c.flush()
+
+
+def build(game_dir):
+    game_js = os.path.join(game_dir, 'game.js')
+    game_data = os.path.join(game_dir, 'game.data')
+    if not os.path.isfile(game_js) or not os.path.isfile(game_data):
+        print('%s: no game.js / game.data, skipped' % game_dir)
+        return
+    package = package_files(game_js)
+    if package is None:
+        print('%s: no package metadata in game.js, skipped' % game_dir)
+        return
+    files, size = package
+    with open(game_data, 'rb') as f:
+        data = f.read()
+    if len(data) != size:
+        sys.exit('%s: game.data is %d bytes, game.js expects %d' % (game_dir, len(data), size))
+
+    # ranges not covered by a file (there normally are none) go in as raw
+    # entries so the rebuilt package is byte for byte the same
+    ranges = []
+    pos = 0
+    for start, end, name in sorted((f['start'], f['end'], f['filename']) for f in files if f['end'] > f['start']):
+        if start > pos:
+            ranges.append((pos, start, ''))
+        ranges.append((start, end, name))
+        pos = end
+    if pos < size:
+        ranges.append((pos, size, ''))
+
+    entries = []
+    for start, end, name in ranges:
+        raw = data[start:end]
+        stored, method = raw, 0
+        if not name.lower().endswith(RAW_TYPES):
+            packed = deflate(raw)
+            if len(raw) - len(packed) >= len(raw) * MIN_SAVING:
+                stored, method = packed, 1
+        entries.append((start, len(raw), stored, method))
+
+    with open(os.path.join(game_dir, 'game.pak'), 'wb') as f:
+        f.write(b'PAK1' + struct.pack('<II', len(entries), size))
+        for start, length, stored, method in entries:
+            f.write(struct.pack('<IIIB', start, length, len(stored), method))
+        for _, _, stored, _ in entries:
+            f.write(stored)
+
+    packed_size = os.path.getsize(os.path.join(game_dir, 'game.pak'))
+    print('%s: %d -> %d bytes (%d entries)' % (game_dir, size, packed_size, len(entries)))
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        sys.exit('usage: pack_data.py <game dir> [<game dir> ...]')
+    for game_dir in sys.argv[1:]:
+        build(game_dir)
@@ -0,0 +1,337 @@
+﻿
+/*
+ *  フレーム計測
+ *
+ *  環境変数 BENCH_FRAMES にフレーム数を指定すると、そのフレーム数だけ
+ *  update_game / draw_game の処理時間を計測して結果を出し終了する。
+ *  SDL_VIDEODRIVER=offscreen SDL_AUDIODRIVER=dummy と合わせて
+ *  ネイティブビルドをウィンドウなしで実行するためのもの。
+ *  指定がなければ何もしない。
+ *
+ *  BENCH_INPUT	入力スクリプト（1行に "フレーム ボタン..."、ボタンは left right up down a b）
+ *  BENCH_OUTPUT	結果を JSON で書き出すファイル
+ *  BENCH_INSTANCES	画面に出さずに同時に動かすゲームの数（同じ入力で動かし、
+ *					全部の update の時間 "step" と1秒あたりの update 回数を出す）
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "Bench.h"
+
+
+#define	INPUT_MAX	1024				// 入力スクリプトの最大行数
+
+
+typedef struct
+{
+	uint64_t	start;				// 開始時刻
+	uint64_t	total;				// 合計時間
+	uint64_t	max;				// 最大時間
+	uint64_t	min;				// 最小時間
+	uint32_t*	sample;				// フレームごとの時間
+	int			count;				// 計測回数
+} Bench;
+
+typedef struct
+{
+	int			frame;				// フレーム
+	PDButtons	button;				// ボタン
+} Input;
+
+static Bench	bench[BENCH_MAX];
+static int		bench_frames;		// 計測フレーム数（0 = 計測しない）
+static int		frame_cnt;			// 計測済みフレーム数
+static int		instance_cnt;		// 計測用に同時に動かすゲーム数
+
+static Input	input[INPUT_MAX];	// 入力スクリプト
+static int		input_cnt;			// 入力スクリプト行数
+static int		input_pos;			// 入力スクリプト位置
+static PDButtons	input_last;		// 前フレームの入力
+
+
+/**********************************
+    現在時刻（ナノ秒）
+ **********************************/
+uint64_t	bench_time(void)
+{
+	struct timespec	_ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &_ts);
+	return	(uint64_t)_ts.tv_sec*1000000000ull + _ts.tv_nsec;
+}
+
+/**********************************************
+    最大常駐メモリ（VmHWM, KB）
+		ヒープだけでなくプロセス全体の最大値
+		戻り値	使用量、取得できなければ 0
+ **********************************************/
+static
+long	get_peak_rss(void)
+{
+	long	_kb = 0;
+	FILE*	_fp = fopen("/proc/self/status", "r");
+	char	_line[128];
+
+	if ( _fp == NULL ) {
+		return	0;
+	}
+	while ( fgets(_line, sizeof(_line), _fp) ) {
+		if ( strncmp(_line, "VmHWM:", 6) == 0 ) {
+			_kb = atol(_line + 6);
+			break;
+		}
+	}
+	fclose(_fp);
+	return	_kb;
+}
+
+/******************************************
+    入力スクリプト読み込み
+		引数	_file = ファイル名
+ ******************************************/
+static
+void	load_input(const char* _file)
+{
+	static const
+	struct
+	{
+		const char*	name;
+		PDButtons	button;
+	} button_name[] =
+	{
+		{"left",	kButtonLeft},
+		{"right",	kButtonRight},
+		{"up",		kButtonUp},
+		{"down",	kButtonDown},
+		{"a",		kButtonA},
+		{"b",		kButtonB},
+	};
+
+	FILE*	_fp = fopen(_file, "r");
+	char	_line[256];
+
+	input_cnt = 0;
+	if ( _fp == NULL ) {
+		printf("bench: cannot open %s\n", _file);
+		return;
+	}
+	while ( fgets(_line, sizeof(_line), _fp) && (input_cnt < INPUT_MAX) ) {
+		char*	_p = strtok(_line, " \t\r\n");
+
+		if ( (_p == NULL) || (*_p == '#') ) {				// 空行・コメント
+			continue;
+		}
+		input[input_cnt].frame = atoi(_p);
+		input[input_cnt].button = 0;
+		while ( (_p = strtok(NULL, " \t\r\n")) != NULL ) {
+			for (int i = 0; i < (int)(sizeof(button_name)/sizeof(button_name[0])); i++) {
+				if ( strcmp(_p, button_name[i].name) == 0 ) {
+					input[input_cnt].button |= button_name[i].button;
+				}
+			}
+		}
+		input_cnt++;
+	}
+	fclose(_fp);
+}
+
+/****************
+    計測初期化
+ ****************/
+void	init_bench(void)
+{
+	const char*	_env = getenv("BENCH_FRAMES");
+
+	bench_frames = (_env != NULL) ? atoi(_env) : 0;
+	frame_cnt = 0;
+	instance_cnt = 0;
+	memset(bench, 0, sizeof(bench));
+	if ( bench_frames <= 0 ) {
+		return;
+	}
+	if ( (_env = getenv("BENCH_INSTANCES")) != NULL ) {
+		instance_cnt = atoi(_env);
+	}
+	for (int i = 0; i < BENCH_MAX; i++) {
+		bench[i].min = UINT64_MAX;
+		bench[i].sample = calloc(bench_frames, sizeof(uint32_t));
+	}
+
+	input_pos = 0;
+	input_last = 0;
+	if ( (_env = getenv("BENCH_INPUT")) != NULL ) {
+		load_input(_env);
+	}
+}
+
+/**********************************
+    計測時間加算
+		引数	_b = 計測区間
+				_t = 時間
+ **********************************/
+static
+void	add_time(Bench* _b, uint64_t _t)
+{
+	_b->total += _t;
+	if ( _t > _b->max ) {
+		_b->max = _t;
+	}
+	if ( _t < _b->min ) {
+		_b->min = _t;
+	}
+	if ( _b->count < bench_frames ) {
+		_b->sample[_b->count] = (_t > UINT32_MAX) ? UINT32_MAX : (uint32_t)_t;
+	}
+	_b->count++;
+}
+
+/**********************************
+    計測開始
+		引数	_n = 計測区間
+ **********************************/
+void	begin_bench(int _n)
+{
+	if ( bench_frames <= 0 ) {
+		return;
+	}
+
+	uint64_t	_t = bench_time();
+
+	if ( _n == BENCH_UPDATE ) {							// 前のフレームからの時間
+		if ( bench[BENCH_FRAME].start != 0 ) {
+			add_time(&bench[BENCH_FRAME], _t - bench[BENCH_FRAME].start);
+		}
+		bench[BENCH_FRAME].start = _t;
+	}
+	bench[_n].start = _t;
+}
+
+/**************************************
+    入力スクリプト適用
+		引数	_button = ボタン入力
+ **************************************/
+void	input_bench(Button* _button)
+{
+	PDButtons	_btn = 0;
+
+	if ( bench_frames <= 0 ) {
+		return;
+	}
+	while ( (input_pos < input_cnt) && (input[input_pos].frame <= frame_cnt) ) {
+		if ( input[input_pos].frame == frame_cnt ) {
+			_btn |= input[input_pos].button;
+		}
+		input_pos++;
+	}
+	_button->push |= _btn;								// 1フレームだけ押す
+	_button->trigger |= _btn;
+	_button->repeat |= _btn;
+	_button->release |= input_last & ~_btn;
+	input_last = _btn;
+}
+
+/**************************************
+    計測用に同時に動かすゲーム数
+		戻り値	ゲーム数（計測しないときは 0）
+ **************************************/
+int		bench_instances(void)
+{
+	return	instance_cnt;
+}
+
+/**************************************
+    サンプル比較（qsort 用）
+ **************************************/
+static
+int		compare_sample(const void* _a, const void* _b)
+{
+	uint32_t	_x = *(const uint32_t*)_a, _y = *(const uint32_t*)_b;
+
+	return	(_x > _y) - (_x < _y);
+}
+
+/******************************************
+    計測結果出力
+ ******************************************/
+static
+void	report_bench(void)
+{
+	static const
+	char*	name[BENCH_MAX] =
+	{
+		"update",
+		"draw",
+		"frame",
+		"init",
+		"step",
+	};
+
+	const char*	_file = getenv("BENCH_OUTPUT");
+	FILE*		_fp = (_file != NULL) ? fopen(_file, "w") : NULL;
+	long		_peak = get_peak_rss();
+
+	printf("bench frames=%d peak_rss=%ldKB\n", frame_cnt, _peak);
+	if ( _fp ) {
+		fprintf(_fp, "{\n  \"frames\": %d,\n  \"peak_rss_kb\": %ld", frame_cnt, _peak);
+	}
+	for (int i = 0; i < BENCH_MAX; i++) {
+		Bench*	_b = &bench[i];
+		int		_n = (_b->count < bench_frames) ? _b->count : bench_frames;
+
+		if ( _n == 0 ) {
+			continue;
+		}
+		qsort(_b->sample, _n, sizeof(uint32_t), compare_sample);
+
+		double	_avg = _b->total/1000.0/_b->count,
+				_p50 = _b->sample[_n/2]/1000.0,
+				_p95 = _b->sample[(_n - 1)*95/100]/1000.0;
+
+		printf("bench %-7s avg=%.3fus p50=%.3fus p95=%.3fus min=%.3fus max=%.3fus\n", name[i],
+				_avg, _p50, _p95, _b->min/1000.0, _b->max/1000.0);
+		if ( _fp ) {
+			fprintf(_fp, ",\n  \"%s\": {\"avg_us\": %.3f, \"p50_us\": %.3f, \"p95_us\": %.3f, \"max_us\": %.3f}",
+					name[i], _avg, _p50, _p95, _b->max/1000.0);
+		}
+	}
+	if ( (instance_cnt > 0) && (bench[BENCH_STEP].total > 0) ) {
+		double	_rate = (double)instance_cnt*bench[BENCH_STEP].count*1000000000.0/bench[BENCH_STEP].total;
+
+		printf("bench instances=%d steps/s=%.0f\n", instance_cnt, _rate);
+		if ( _fp ) {
+			fprintf(_fp, ",\n  \"instances\": %d,\n  \"steps_per_s\": %.0f", instance_cnt, _rate);
+		}
+	}
+	if ( _fp ) {
+		fprintf(_fp, "\n}\n");
+		fclose(_fp);
+	}
+	fflush(stdout);
+
+	for (int i = 0; i < BENCH_MAX; i++) {
+		free(bench[i].sample);
+		bench[i].sample = NULL;
+	}
+}
+
+/******************************************
+    計測終了
+		引数	_n = 計測区間
+		戻り値	指定フレーム数の計測が終わったか
+ ******************************************/
+bool	end_bench(int _n)
+{
+	if ( bench_frames <= 0 ) {
+		return	false;
+	}
+
+	add_time(&bench[_n], bench_time() - bench[_n].start);
+
+	if ( (_n != BENCH_DRAW) || (++frame_cnt < bench_frames) ) {
+		return	false;
+	}
+	report_bench();
+	return	true;
+}
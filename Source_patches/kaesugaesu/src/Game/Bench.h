@@ -0,0 +1,29 @@
+﻿
+#ifndef	___BENCH_H___
+#define	___BENCH_H___
+
+#include <stdint.h>
+
+#include "App.h"
+
+
+/*** 計測区間 *******/
+enum
+{
+	BENCH_UPDATE,						// update_game
+	BENCH_DRAW,							// draw_game
+	BENCH_FRAME,						// 1フレーム全体
+	BENCH_INIT,							// init_game（素材読み込み）
+	BENCH_STEP,							// 計測用のゲーム全部の update
+	BENCH_MAX,
+};
+
+
+void	init_bench(void);								// 計測初期化
+void	begin_bench(int);								// 計測開始
+bool	end_bench(int);									// 計測終了
+void	input_bench(Button*);							// 入力スクリプト適用
+int		bench_instances(void);							// 計測用に同時に動かすゲーム数
+uint64_t	bench_time(void);							// 現在時刻（ナノ秒）
+
+#endif
@@ -0,0 +1,25 @@
+﻿#ifndef	___CONTEXT_H___
+#define	___CONTEXT_H___
+
+#include "App.h"
+
+
+/*
+ *  ゲーム状態
+ *
+ *  init_game / update_game / draw_game / quit_game は画面に出すゲーム1つを
+ *  動かす。以下を使うと同じプロセスでいくつでもゲームを動かせる
+ *  （自動テストなどで画面に出さずに大量に動かすためのもの）。
+ *  素材は全ゲームで共有するので、先に load_resources を呼んでおくこと。
+ */
+typedef struct GameContext	GameContext;
+
+
+void			load_resources(void);							// 素材読み込み
+void			free_resources(void);							// 素材解放
+GameContext*	new_context(bool);								// ゲーム作成
+void			free_context(GameContext*);						// ゲーム削除
+void			update_context(GameContext*, const Button*);	// 稼働
+bool			draw_context(GameContext*);						// 描画
+
+#endif
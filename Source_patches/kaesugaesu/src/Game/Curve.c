@@ -0,0 +1,71 @@
+﻿
+#include "Curve.h"
+
+
+static const
+int		curve_len[CURVE_MAX] =							// カーブの長さ
+{
+	MOVE_TIME + 1,
+	STOP_TIME + 1,
+	WAVE_TIME,
+	LOGO_TIME,
+};
+
+static int	curve[CURVE_MAX][WAVE_TIME];				// カーブテーブル（一番長いカーブに合わせる）
+
+
+/**********************************
+    アニメーションカーブ作成
+ **********************************/
+void	init_curve(void)
+{
+	for (int i = 0; i <= MOVE_TIME; i++) {				// カーソル移動（2乗で減速）
+		curve[CURVE_MOVE][i] = i*i*CURVE_ONE/(MOVE_TIME*MOVE_TIME);
+	}
+	for (int i = 0, _h = STOP_TIME/2; i <= STOP_TIME; i++) {		// 移動不可（切り上げて整数演算と合わせる）
+		int		_t = _h - i;
+
+		curve[CURVE_STOP][i] = ((_h*_h - _t*_t)*CURVE_ONE + _h*_h*_h - 1)/(_h*_h*_h);
+	}
+	for (int i = 0; i < WAVE_TIME; i++) {				// "CLEAR!" 揺れ
+		curve[CURVE_WAVE][i] = (int)roundf(cosf(i*(M_PI*2/WAVE_TIME))*CURVE_ONE);
+	}
+	for (int i = 0; i < LOGO_TIME; i++) {				// タイトルロゴ回転
+		curve[CURVE_LOGO][i] = (int)roundf(cosf(i*(M_PI*2/LOGO_TIME))*CURVE_ONE);
+	}
+}
+
+/****************************************
+    カーブ値取得
+		引数	_curve = カーブ番号
+				_frame = フレーム
+		戻り値	カーブ値（CURVE_ONE = 1.0）
+ ****************************************/
+int		get_curve(int _curve, int _frame)
+{
+	if ( _curve >= CURVE_WAVE ) {						// 周期カーブ
+		_frame %= curve_len[_curve];
+		if ( _frame < 0 ) {
+			_frame += curve_len[_curve];
+		}
+	}
+	else if ( _frame < 0 ) {
+		_frame = 0;
+	}
+	else if ( _frame >= curve_len[_curve] ) {
+		_frame = curve_len[_curve] - 1;
+	}
+	return	curve[_curve][_frame];
+}
+
+/****************************************
+    カーブ値取得（スケール付き）
+		引数	_curve = カーブ番号
+				_frame = フレーム
+				_scale = 1.0 の時の値
+		戻り値	カーブ値
+ ****************************************/
+int		scale_curve(int _curve, int _frame, int _scale)
+{
+	return	get_curve(_curve, _frame)*_scale/CURVE_ONE;
+}
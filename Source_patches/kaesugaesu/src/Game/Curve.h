@@ -0,0 +1,31 @@
+﻿
+#ifndef	___CURVE_H___
+#define	___CURVE_H___
+
+#include "App.h"
+
+
+#define	CURVE_ONE	(1 << 12)			// 固定小数点の 1.0
+
+#define	MOVE_TIME	8					// カーソル移動時間
+#define	STOP_TIME	6					// 移動不可時間
+#define	WAVE_TIME	48					// "CLEAR!" 揺れ周期
+#define	LOGO_TIME	20					// タイトルロゴ回転時間
+
+
+/*** カーブ番号 *******/
+enum
+{
+	CURVE_MOVE,							// カーソル移動（減速）
+	CURVE_STOP,							// 移動不可（跳ね返り）
+	CURVE_WAVE,							// "CLEAR!" 揺れ
+	CURVE_LOGO,							// タイトルロゴ回転
+	CURVE_MAX,
+};
+
+
+void	init_curve(void);								// アニメーションカーブ作成
+int		get_curve(int, int);							// カーブ値取得
+int		scale_curve(int, int, int);						// カーブ値取得（スケール付き）
+
+#endif
@@ -1,6 +1,12 @@
 ﻿
 #include "Game.h"
 #include "Panel.h"
+#include "Curve.h"
+#include "Bench.h"
+#include "Memory.h"
+#include "Pool.h"
+#include "Trace.h"
+#include "Context.h"
 
 
 #define	BACK_MAX	25				// 背景画像数
@@ -8,6 +14,10 @@
 #define	FIELD_W		4				// パネルの数
 #define	FIELD_H		FIELD_W
 
+#define	FRAME_RATE	30				// 通常のフレームレート
+#define	IDLE_RATE	10				// 待機中のフレームレート
+#define	IDLE_WAIT	30				// 待機に入るまでのフレーム数
+
 
 /*** 状態 *******/
 enum
@@ -48,85 +58,163 @@ typedef struct
 	int		correct;			// 正解ルート
 } Line;
 
+/****************
+    問題データ
+ ****************/
+typedef struct
+{
+	int		level;						// 難易度（-1 = なし）
+	bool	ready;						// 作成済みか
+	Line	line_h[FIELD_H + 1][FIELD_W];	// 横ライン
+	Line	line_v[FIELD_H][FIELD_W + 1];	// 縦ライン
+	int		side[FIELD_H][FIELD_W];		// パネルの向き（フリーモード）
+	int		cursor_x, cursor_y;			// カーソル位置
+} Puzzle;
 
-static Panel		panel[FIELD_H][FIELD_W];			// パネル
-static Line			line_h[FIELD_H + 1][FIELD_W];		// 横ライン
-static Line			line_v[FIELD_H][FIELD_W + 1];		// 縦ライン
-static int			field_w, field_h;					// フィールドの大きさ
-static int			field_x, field_y;					// フィールドの位置
 
-static int			cursor_x, cursor_y;					// カーソル位置
-static int			cursor_dx, cursor_dy;				// 移動方向
-static int			move_cnt;							// 移動カウンタ
-static Line*		current_line;						// 移動中のライン
-static PDButtons	undo[FIELD_W*FIELD_H*2];			// やり直しバッファ
-static int			undo_cnt;							// やり直しカウンタ
-static bool			flag_answer;						// 解答表示フラグ
+/****************
+    ゲーム状態
+ ****************/
+struct GameContext
+{
+	bool		primary;						// 画面・サウンド・メニューを使うか
+	Button		button;							// ボタン入力
+	int			fade, fade_step;				// フェード（primary 以外）
+
+	Panel		panel[FIELD_H][FIELD_W];		// パネル
+	Panel*		anim_list[FIELD_W*FIELD_H];		// アニメーション中のパネル
+	int			anim_cnt;						// アニメーション中のパネル数
+	bool		anim_flag[FIELD_W*FIELD_H];		// アニメーション登録フラグ
+	Line		line_h[FIELD_H + 1][FIELD_W];	// 横ライン
+	Line		line_v[FIELD_H][FIELD_W + 1];	// 縦ライン
+	int			field_w, field_h;				// フィールドの大きさ
+	int			field_x, field_y;				// フィールドの位置
+
+	int			cursor_x, cursor_y;				// カーソル位置
+	int			cursor_dx, cursor_dy;			// 移動方向
+	int			move_cnt;						// 移動カウンタ
+	Line*		current_line;					// 移動中のライン
+	PDButtons	undo[FIELD_W*FIELD_H*2];		// やり直しバッファ
+	int			undo_cnt;						// やり直しカウンタ
+	bool		flag_answer;					// 解答表示フラグ
+	Puzzle		next_puzzle;					// 次の問題
+	PDMenuItem*	item_answer;					// 解答表示メニュー
+
+	int			phase;							// 状態
+	int			cnt;							// 汎用カウンタ
+	int			level;							// 選択レベル
+	bool		free_mode;						// フリーモードか
+
+	int			back_num;						// 背景番号
+	LCDBitmap*	bmp_back;						// 背景
+	LCDBitmap*	bmp_game;						// ゲーム画面バッファ
+	bool		flag_draw;						// 描画フラグ
+	int			draw_state;						// 前回の表示状態
+	int			idle_cnt;						// 表示変化なしのフレーム数
+	bool		idle_rate;						// フレームレートを落としているか
+};
 
-static int			phase;								// 状態
-static int			cnt;								// 汎用カウンタ
-static int			level;								// 選択レベル
-static bool			free_mode;							// フリーモードか
 
-static int				back_num;						// 背景番号
-static LCDBitmap*		bmp_back;						// 背景
+/*** 全ゲーム共通の素材 *******/
 static LCDBitmap*		bmp_base;						// パネル下地
 static LCDBitmap*		bmp_cursor[4];					// カーソル
 static LCDBitmap*		bmp_clear[176/8];				// クリア
 static LCDBitmap*		bmp_logo[4];					// タイトルロゴ
-static LCDBitmap*		bmp_level[4];					// レベル選択
-static LCDBitmap*		bmp_select;						// 選択中
-static LCDBitmap*		bmp_board;						// 選択背景
-
-static LCDBitmap*		bmp_game;						// ゲーム画面バッファ
-static bool				flag_draw;						// 描画フラグ
+static LCDBitmap*		bmp_menu[4];					// レベル選択画面（選択中のレベル別）
 
 static AudioSample*		se_data[SE_MAX];				// SE
 static SamplePlayer*	se_player[4];					// SEプレイヤー
 static FilePlayer*		bgm_player;						// BGMプレイヤー
 
+static GameContext*		main_context;					// 画面に出すゲーム
+static GameContext**	bench_context;					// 計測用に同時に動かすゲーム
+static int				bench_context_cnt;
+
 
 
-static void		load_back(void);		// 背景読み込み
-static void		play_bgm(int);			// BGM再生
+static void		load_back(GameContext*);		// 背景読み込み
+static void		play_bgm(GameContext*, int);	// BGM再生
+static void		clear_anim(GameContext*);		// アニメーション登録解除
+static void		make_menu(void);				// レベル選択画面作成
 
-/************
+/**************************************
     初期化
- ************/
+		画面に出すゲームを1つ作る
+		BENCH_INSTANCES の数だけ計測用のゲームも作る
+ **************************************/
 void	init_game(void)
 {
-	back_num = -1;
-	load_back();											// 背景
-	bmp_base = load_bitmap("images/base");					// パネル下地
+	init_trace();											// API 呼び出し記録
+	init_curve();											// アニメーションカーブ
+	init_bench();											// フレーム計測
+	init_memory();											// メモリ記録
+	begin_bench(BENCH_INIT);
 
-	LCDBitmap*	_tmp = load_bitmap("images/cursor");		// カーソル
-	for (int i = 0; i < 4; i++) {
-		bmp_cursor[i] = cut_bitmap(_tmp, i*32, 0, 32, 32);
+	load_resources();										// 素材
+	main_context = new_context(true);						// ゲーム状態
+
+	bench_context_cnt = bench_instances();
+	if ( bench_context_cnt > 0 ) {
+		bench_context = pd->system->realloc(NULL, bench_context_cnt*sizeof(GameContext*));
+		for (int i = 0; i < bench_context_cnt; i++) {
+			bench_context[i] = new_context(false);
+		}
 	}
-	gfx->freeBitmap(_tmp);
 
-	_tmp = load_bitmap("images/clear");						// クリア
-	for (int i = 0; i < 176/8; i++) {
-		bmp_clear[i] = cut_bitmap(_tmp, i*8, 0, 8, 32);
+	play_bgm(main_context, BGM_MENU);
+
+	end_bench(BENCH_INIT);
+}
+
+/**********
+    終了
+ **********/
+void	quit_game(void)
+{
+	for (int i = 0; i < bench_context_cnt; i++) {
+		free_context(bench_context[i]);
+	}
+	if ( bench_context ) {
+		pd->system->realloc(bench_context, 0);
+		bench_context = NULL;
 	}
-	gfx->freeBitmap(_tmp);
+	bench_context_cnt = 0;
+
+	free_context(main_context);
+	main_context = NULL;
+	free_pool();											// 使い回し用のビットマップ
+	free_resources();
 
-	_tmp = load_bitmap("images/logo");						// タイトルロゴ
+	report_memory();										// メモリ使用量表示
+	quit_trace();											// API 呼び出し記録書き出し
+}
+
+/******************
+    素材読み込み
+ ******************/
+void	load_resources(void)
+{
+	bmp_base = track_bitmap(load_bitmap("images/base"), "base");					// パネル下地
+
+	LCDBitmap*	_tmp = track_bitmap(load_bitmap("images/cursor"), "cursor");		// カーソル
 	for (int i = 0; i < 4; i++) {
-		bmp_logo[i] = cut_bitmap(_tmp, i*56, 0, 56, 50);
+		bmp_cursor[i] = track_bitmap(cut_bitmap(_tmp, i*32, 0, 32, 32), "cursor");
 	}
-	gfx->freeBitmap(_tmp);
+	free_bitmap(_tmp);
 
-	_tmp = load_bitmap("images/level");						// レベル
-	for (int i = 0; i < 4; i++) {
-		bmp_level[i] = cut_bitmap(_tmp, 0, 24*i, 80, 24);
+	_tmp = track_bitmap(load_bitmap("images/clear"), "clear");						// クリア
+	for (int i = 0; i < 176/8; i++) {
+		bmp_clear[i] = track_bitmap(cut_bitmap(_tmp, i*8, 0, 8, 32), "clear");
 	}
-	gfx->freeBitmap(_tmp);
+	free_bitmap(_tmp);
 
-	bmp_select = load_bitmap("images/select");				// 選択中
-	bmp_board = load_bitmap("images/board");				// 選択背景
+	_tmp = track_bitmap(load_bitmap("images/logo"), "logo");						// タイトルロゴ
+	for (int i = 0; i < 4; i++) {
+		bmp_logo[i] = track_bitmap(cut_bitmap(_tmp, i*56, 0, 56, 50), "logo");
+	}
+	free_bitmap(_tmp);
 
-	bmp_game = gfx->copyBitmap(bmp_back);					// ゲーム画面バッファ
+	make_menu();											// レベル選択画面
 
 
 	static const
@@ -140,61 +228,90 @@ void	init_game(void)
 	};
 
 	bgm_player = pd->sound->fileplayer->newPlayer();		// BGMプレイヤー
+	track_alloc(MEM_PLAYER, bgm_player, 0, "bgm");
 	for (int i = 0; i < 4; i++) {							// SEプレイヤー
 		se_player[i] = pd->sound->sampleplayer->newPlayer();
+		track_alloc(MEM_PLAYER, se_player[i], 0, "se");
 	}
 	for (int i = 0; i < SE_MAX; i++) {						// SEデータ
-		se_data[i] = pd->sound->sample->load(se_file[i]);
+		se_data[i] = track_sample(pd->sound->sample->load(se_file[i]), se_file[i]);
 	}
-
-
-	memset(&panel[0][0], 0, sizeof(panel));					// パネル
-
-	phase	= PHASE_TITLE;
-	cnt		= 150;
-	level	= 0;
-
-	play_bgm(BGM_MENU);
 }
 
-/**********
-    終了
- **********/
-void	quit_game(void)
+/**************
+    素材解放
+ **************/
+void	free_resources(void)
 {
-	gfx->freeBitmap(bmp_back);								// 背景
-	gfx->freeBitmap(bmp_base);								// パネル下地
+	free_bitmap(bmp_base);								// パネル下地
 	for (int i = 0; i < 4; i++) {							// カーソル
-		gfx->freeBitmap(bmp_cursor[i]);
+		free_bitmap(bmp_cursor[i]);
 	}
 	for (int i = 0; i < 176/8; i++) {						// クリア
-		gfx->freeBitmap(bmp_clear[i]);
+		free_bitmap(bmp_clear[i]);
 	}
 	for (int i = 0; i < 4; i++) {							// タイトルロゴ
-		gfx->freeBitmap(bmp_logo[i]);
+		free_bitmap(bmp_logo[i]);
 	}
-	for (int i = 0; i < 4; i++) {							// レベル
-		gfx->freeBitmap(bmp_level[i]);
+	for (int i = 0; i < 4; i++) {							// レベル選択画面
+		free_bitmap(bmp_menu[i]);
 	}
-	gfx->freeBitmap(bmp_select);							// 選択中
-	gfx->freeBitmap(bmp_board);								// 選択背景
-	gfx->freeBitmap(bmp_game);								// ゲーム画面バッファ
 
 	pd->sound->fileplayer->stop(bgm_player);
+	track_free(bgm_player);
 	pd->sound->fileplayer->freePlayer(bgm_player);			// BGMプレイヤー
 	for (int i = 0; i < 4; i++) {							// SEプレイヤー
 		pd->sound->sampleplayer->stop(se_player[i]);
+		track_free(se_player[i]);
 		pd->sound->sampleplayer->freePlayer(se_player[i]);
 	}
 	for (int i = 0; i < SE_MAX; i++) {						// SEデータ
-		pd->sound->sample->freeSample(se_data[i]);
+		free_sample(se_data[i]);
 	}
+}
+
+/******************************************************
+    ゲーム作成
+		引数	_primary = 画面・サウンド・メニューを使うか
+				（使うのは1つだけ、他は画面に出さずに動かす）
+		戻り値	ゲーム状態
+ ******************************************************/
+GameContext*	new_context(bool _primary)
+{
+	GameContext*	_g = pd->system->realloc(NULL, sizeof(GameContext));
+
+	memset(_g, 0, sizeof(GameContext));						// パネル
+	_g->primary		= _primary;
+	_g->next_puzzle.level = -1;
+	_g->draw_state	= -1;
+
+	_g->back_num = -1;
+	load_back(_g);											// 背景
+	_g->bmp_game = track_bitmap(gfx->copyBitmap(_g->bmp_back), "game");		// ゲーム画面バッファ
+	clear_anim(_g);
+
+	_g->phase	= PHASE_TITLE;
+	_g->cnt		= 150;
+	_g->level	= 0;
+	return	_g;
+}
+
+/**********************************
+    ゲーム削除
+		引数	_g = ゲーム状態
+ **********************************/
+void	free_context(GameContext* _g)
+{
+	free_bitmap(_g->bmp_back);								// 背景
+	free_bitmap(_g->bmp_game);								// ゲーム画面バッファ
 
 	for (int i = 0; i < FIELD_H; i++) {						// パネル
 		for (int j = 0; j < FIELD_W; j++) {
-			quit_panel(&panel[i][j]);
+			quit_panel(&_g->panel[i][j]);
 		}
 	}
+	clear_anim(_g);
+	pd->system->realloc(_g, 0);
 }
 
 
@@ -202,23 +319,81 @@ void	quit_game(void)
     背景読み込み
  ******************/
 static
-void	load_back(void)
+void	load_back(GameContext* _g)
 {
-	if ( back_num >= 0 ) {
-		gfx->freeBitmap(bmp_back);
-	}
-
 	int		_t;
 	do {
 		_t = rand() % BACK_MAX;
-	} while ( _t == back_num );
-	back_num = _t;
+	} while ( _t == _g->back_num );
+
+	char	_file[32];
 
-	char*	_file;
+	snprintf(_file, sizeof(_file), "images/back%02d", _t);
+	if ( _g->back_num >= 0 ) {
+		if ( gfx->loadIntoBitmap ) {						// 前の背景のビットマップに読み込み直す
+			const char*	_err = NULL;
 
-	pd->system->formatString(&_file, "images/back%02d", back_num);
-	bmp_back = load_bitmap(_file);
-	pd->system->realloc(_file, 0);
+			gfx->loadIntoBitmap(_file, _g->bmp_back, &_err);
+			if ( _err == NULL ) {
+				_g->back_num = _t;
+				return;
+			}
+		}
+		free_bitmap(_g->bmp_back);
+	}
+	_g->back_num = _t;
+	_g->bmp_back = track_bitmap(load_bitmap(_file), _file);
+}
+
+/**************************************************
+    レベル選択画面作成
+		選択中のレベルごとに合成済みの画面を作る
+ **************************************************/
+static
+void	make_menu(void)
+{
+	static const
+	int		item_y[] = {72, 108, 144, 184};
+
+	const int	_x0 = 120, _y0 = 40;							// 画面上の位置
+
+	LCDBitmap*	_board = track_bitmap(load_bitmap("images/board"), "board");		// 選択背景
+	LCDBitmap*	_select = track_bitmap(load_bitmap("images/select"), "select");	// 選択中
+	LCDBitmap*	_level[4];									// レベル
+	LCDBitmap*	_tmp = track_bitmap(load_bitmap("images/level"), "level");
+	int			_w, _h, _rowbytes;
+	uint8_t		*_mask, *_data;
+
+	for (int i = 0; i < 4; i++) {
+		_level[i] = track_bitmap(cut_bitmap(_tmp, 0, 24*i, 80, 24), "level");
+	}
+	free_bitmap(_tmp);
+
+	gfx->getBitmapData(_board, &_w, &_h, &_rowbytes, &_mask, &_data);
+	for (int n = 0; n < 4; n++) {
+		bmp_menu[n] = track_bitmap(gfx->newBitmap(_w, _h, kColorClear), "menu");
+		gfx->pushContext(bmp_menu[n]);
+		gfx->drawBitmap(_board, 0, 0, kBitmapUnflipped);							// 背景
+		for (int i = 0; i < 4; i++) {
+			if ( i == n ) {								// 選択中
+				gfx->setDrawMode(kDrawModeWhiteTransparent);
+				gfx->drawBitmap(_select, 136 - _x0, item_y[i] - 16 - _y0, kBitmapUnflipped);	// 下地
+				gfx->setDrawMode(kDrawModeInverted);
+			}
+			else {
+				gfx->setDrawMode(kDrawModeWhiteTransparent);
+			}
+			gfx->drawBitmap(_level[i], 160 - _x0, item_y[i] - 12 - _y0, kBitmapUnflipped);	// レベル
+		}
+		gfx->setDrawMode(kDrawModeCopy);
+		gfx->popContext();
+	}
+
+	for (int i = 0; i < 4; i++) {
+		free_bitmap(_level[i]);
+	}
+	free_bitmap(_select);
+	free_bitmap(_board);
 }
 
 /********************************
@@ -226,7 +401,7 @@ void	load_back(void)
 		引数	_bgm = BGM番号
  ********************************/
 static
-void	play_bgm(int _bgm)
+void	play_bgm(GameContext* _g, int _bgm)
 {
 	static const
 	char*	bgm_file[] =
@@ -235,315 +410,547 @@ void	play_bgm(int _bgm)
 		"sounds/bgm_game_adpcm",
 	};
 
+	if ( !_g->primary ) {
+		return;
+	}
 	pd->sound->fileplayer->stop(bgm_player);
 	pd->sound->fileplayer->loadIntoPlayer(bgm_player, bgm_file[_bgm]);
 	pd->sound->fileplayer->setVolume(bgm_player, 1.0f, 1.0f);
 	pd->sound->fileplayer->play(bgm_player, 0);
 }
 
+/**************************************
+    BGMフェードアウト
+		引数	_len = フェード時間（サンプル数）
+ **************************************/
+static
+void	fade_bgm(GameContext* _g, int _len)
+{
+	if ( _g->primary ) {
+		pd->sound->fileplayer->fadeVolume(bgm_player, 0.0f, 0.0f, _len, NULL, NULL);
+	}
+}
+
 /*******************************
     SE再生
 		引数	_se = SEM番号
  *******************************/
 static
-void	play_se(int _se)
+void	play_se(GameContext* _g, int _se)
 {
 	static int	track = 0;
 
+	if ( !_g->primary ) {
+		return;
+	}
 	pd->sound->sampleplayer->setSample(se_player[track], se_data[_se]);
 	pd->sound->sampleplayer->play(se_player[track], 1, 1.0f);
 	track = ++track % 4;
 }
 
 
-static bool		check_clear(void);		// クリアチェック
+/******************************************************
+    画面フェード開始
+		引数	_out = フェードアウトか
+		画面に出すゲームは App のフェード、他はカウンタだけ
+ ******************************************************/
+static
+void	start_fade(GameContext* _g, bool _out)
+{
+	if ( _g->primary ) {
+		if ( _out ) {
+			fade_out();
+		}
+		else {
+			fade_in();
+		}
+	}
+	else {
+		_g->fade_step = _out ? 1 : -1;
+	}
+}
 
-/*********************************
-    問題作成
+/**********************************
+    画面フェード状態
+		戻り値	フェードカウンタ
+ **********************************/
+static
+int		get_fade(GameContext* _g)
+{
+	return	_g->primary ? fade_cnt : _g->fade;
+}
+
+
+/************************************
+    アニメーション登録
+		引数	_panel = パネル
+ ************************************/
+static
+void	entry_anim(GameContext* _g, Panel* _panel)
+{
+	int		_n = _panel - &_g->panel[0][0];
+
+	if ( !_g->anim_flag[_n] ) {
+		_g->anim_flag[_n] = true;
+		_g->anim_list[_g->anim_cnt++] = _panel;
+	}
+}
+
+/**************************
+    アニメーション稼働
+		戻り値	稼働中か
+ **************************/
+static
+bool	update_anim(GameContext* _g)
+{
+	bool	_active = false;
+
+	for (int i = 0; i < _g->anim_cnt; ) {
+		Panel*	_panel = _g->anim_list[i];
+
+		if ( update_panel(_panel) ) {
+			_active = true;
+			i++;
+		}
+		else {											// 終了したパネルを外す
+			_g->anim_flag[_panel - &_g->panel[0][0]] = false;
+			_g->anim_list[i] = _g->anim_list[--_g->anim_cnt];
+		}
+	}
+	return	_active;
+}
+
+/****************************
+    アニメーション登録解除
+ ****************************/
+static
+void	clear_anim(GameContext* _g)
+{
+	memset(_g->anim_flag, 0, sizeof(_g->anim_flag));
+	_g->anim_cnt = 0;
+}
+
+/******************************
+    パネル反転（登録付き）
+		引数	_panel = パネル
+ ******************************/
+static
+void	flip_h(GameContext* _g, Panel* _panel)
+{
+	reverse_h(_panel);
+	entry_anim(_g, _panel);
+}
+
+static
+void	flip_v(GameContext* _g, Panel* _panel)
+{
+	reverse_v(_panel);
+	entry_anim(_g, _panel);
+}
+
+
+static bool		check_clear(GameContext*);		// クリアチェック
+
+/**********************************
+    フィールドの大きさ
 		引数	_level = 難易度
- *********************************/
+		戻り値	縦横のパネル数
+ **********************************/
 static
-void	init_field(int _level)
+int		field_size(int _level)
 {
+	return	(_level == 0) ? 3 : 4;
+}
+
+/*********************************************
+    問題作成（1回分）
+		引数	_p = 作成先
+				_level = 難易度
+		戻り値	作成できたか（できなければ作り直す）
+ *********************************************/
+static
+bool	make_field(Puzzle* _p, int _level)
+{
+	Line	(*_lh)[FIELD_W] = _p->line_h;
+	Line	(*_lv)[FIELD_W + 1] = _p->line_v;
+	int		_fw = field_size(_level), _fh = _fw;
 	int		i, j, _sx, _sy, _ex, _ey, _len, _x, _y;
-	bool	_clear = true;
 
+	memset(_p->line_h, 0, sizeof(_p->line_h));		// ライン情報クリア
+	memset(_p->line_v, 0, sizeof(_p->line_v));
+
+	_sx = rand() % (_fw + 1);					// 出発点
+	_sy = rand() % (_fh + 1);
+	_len = (_level == 0) ? 2 : ((_level == 1) ? (_fw + _fh)*4/5 : (_fw + _fh)*3/2);			// 最低限の長さ
+	if ( _level == 0 ) {
+		i = 1;
+		j = 4;
+	}
+	else {
+		i = 2;
+		j = FIELD_W + FIELD_H;
+	}
 	do {
-		memset(&line_h[0][0], 0, sizeof(line_h));		// ライン情報クリア
-		memset(&line_v[0][0], 0, sizeof(line_v));
+		_ex = rand() % (_fw + 1);				// 到着点
+		_ey = rand() % (_fh + 1);
+		_x = abs(_sx - _ex) + abs(_sy - _ey);
+	} while ( (_x <= i) || (_x >= j) );
+
+	if ( _sx < _ex ) {								// 最短経路設定
+		i = _sx;
+		j = _ex;
+	}
+	else {
+		i = _ex;
+		j = _sx;
+	}
+	for (; i < j; i++) {
+		_lh[_sy][i].correct = 1;
+		_len--;
+	}
+	if ( _sy < _ey ) {
+		i = _sy;
+		j = _ey;
+	}
+	else {
+		i = _ey;
+		j = _sy;
+	}
+	for (; i < j; i++) {
+		_lv[i][_ex].correct = 1;
+		_len--;
+	}
 
-		_sx = rand() % (field_w + 1);					// 出発点
-		_sy = rand() % (field_h + 1);
-		_len = (_level == 0) ? 2 : ((_level == 1) ? (field_w + field_h)*4/5 : (field_w + field_h)*3/2);			// 最低限の長さ
-		if ( _level == 0 ) {
-			i = 1;
-			j = 4;
-		}
-		else {
-			i = 2;
-			j = FIELD_W + FIELD_H;
-		}
+	int		_x1 = -1, _y1 = -1;
+
+	for (i = (_level == 0) ? 1 : ((_level == 1) ? 5 : 30); (i > 0) || (_len > 0); i--) {			// 経路シャッフル
+		int		_t;
 		do {
-			_ex = rand() % (field_w + 1);				// 到着点
-			_ey = rand() % (field_h + 1);
-			_x = abs(_sx - _ex) + abs(_sy - _ey);
-		} while ( (_x <= i) || (_x >= j) );
+			_x = rand() % _fw;
+			_y = rand() % _fh;
+			if ( (_lh[_y][_x].correct == _lh[_y + 1][_x].correct) && (_lv[_y][_x].correct == _lv[_y][_x + 1].correct) ) {
+				_t = 3;
+			}
+			else {
+				_t = 0;
+				if ( _x > 0 ) {
+					_t += _lh[_y][_x - 1].correct + _lh[_y + 1][_x - 1].correct;
+				}
+				if ( _x < _fw - 1 ) {
+					_t += _lh[_y][_x + 1].correct + _lh[_y + 1][_x + 1].correct;
+				}
+				if ( _y > 0 ) {
+					_t += _lv[_y - 1][_x].correct + _lv[_y - 1][_x + 1].correct;
+				}
+				if ( _y < _fh - 1 ) {
+					_t += _lv[_y + 1][_x].correct + _lv[_y + 1][_x + 1].correct;
+				}
+				if ( ((_x == _sx) || (_x + 1 == _sx)) && ((_y == _sy) || (_y + 1 == _sy)) && ((_x == _ex) || (_x + 1 == _ex)) || ((_y == _ey) && (_y + 1 == _ey)) ) {
+					_t++;
+				}
+			}
+		} while ( _t > 2 );
+		if ( (_x == _x1) && (_y == _y1) ) {
+			i += 2;
+		}
+		_x1 = _x;
+		_y1 = _y;
+
+		_len += _lh[_y][_x].correct + _lh[_y + 1][_x].correct + _lv[_y][_x].correct + _lv[_y][_x + 1].correct;
+		_lh[_y    ][_x    ].correct ^= 1;
+		_lh[_y + 1][_x    ].correct ^= 1;
+		_lv[_y    ][_x    ].correct ^= 1;
+		_lv[_y    ][_x + 1].correct ^= 1;
+		_len -= _lh[_y][_x].correct + _lh[_y + 1][_x].correct + _lv[_y][_x].correct + _lv[_y][_x + 1].correct;
+	}
 
-		if ( _sx < _ex ) {								// 最短経路設定
-			i = _sx;
-			j = _ex;
-		}
-		else {
-			i = _ex;
-			j = _sx;
+	if ( _ex + _ey == 1 ) {							// 左上
+		_lh[0][0].correct = 0;
+		_lv[0][0].correct = 0;
+		if ( _len > -2 ) {
+			return	false;
 		}
-		for (; i < j; i++) {
-			line_h[_sy][i].correct = 1;
-			_len--;
+	}
+	if ( _fw - _ex + _ey == 1 ) {				// 右上
+		_lh[0][_fw - 1].correct = 0;
+		_lv[0][_fw].correct = 0;
+		if ( _len > -2 ) {
+			return	false;
 		}
-		if ( _sy < _ey ) {
-			i = _sy;
-			j = _ey;
+	}
+	if ( _ex + _fh - _ey == 1 ) {				// 左下
+		_lh[_fh][0].correct = 0;
+		_lv[_fh - 1][0].correct = 0;
+		if ( _len > -2 ) {
+			return	false;
 		}
-		else {
-			i = _ey;
-			j = _sy;
+	}
+	if ( _fw - _ex + _fh - _ey == 1 ) {		// 右下
+		_lh[_fh][_fw - 1].correct = 0;
+		_lv[_fh - 1][_fw].correct = 0;
+		if ( _len > -2 ) {
+			return	false;
 		}
-		for (; i < j; i++) {
-			line_v[i][_ex].correct = 1;
-			_len--;
+	}
+
+	for (i = 0; i < _fh; i++) {						// 全パネルが揃っていたら作り直す
+		for (j = 0; j < _fw; j++) {
+			if ( _lh[i][j].correct ^ _lh[i + 1][j].correct ^ _lv[i][j].correct ^ _lv[i][j + 1].correct ) {
+				_p->cursor_x = _sx;						// カーソル位置
+				_p->cursor_y = _sy;
+				return	true;
+			}
 		}
+	}
+	return	false;
+}
 
-		int		_x1 = -1, _y1 = -1;
+/*********************************************
+    問題作成（フリーモード、1回分）
+		引数	_p = 作成先
+		戻り値	作成できたか（できなければ作り直す）
+ *********************************************/
+static
+bool	make_field_free(Puzzle* _p)
+{
+	int		_fw = field_size(3), _fh = _fw;
+	int		_x = _p->cursor_x, _y = _p->cursor_y;
+	int		_m = -1, _n;
 
-		for (i = (_level == 0) ? 1 : ((_level == 1) ? 5 : 30); (i > 0) || (_len > 0); i--) {			// 経路シャッフル
-			int		_t;
-			do {
-				_x = rand() % field_w;
-				_y = rand() % field_h;
-				if ( (line_h[_y][_x].correct == line_h[_y + 1][_x].correct) && (line_v[_y][_x].correct == line_v[_y][_x + 1].correct) ) {
-					_t = 3;
+	for (int i = 0; i < _fh; i++) {				// パネル初期化
+		for (int j = 0; j < _fw; j++) {
+			_p->side[i][j] = 0;
+		}
+	}
+	for (int i = 0; i < 50; i++) {
+		do {
+			_n = rand() % 4;
+		} while ( _n == _m );
+		switch ( _n ) {
+		  case 0 :					// →
+			if ( _x < _fw ) {
+				_x++;
+				if ( _y > 0 ) {						// パネル反転
+					_p->side[_y - 1][_x - 1] ^= 0x02;
 				}
-				else {
-					_t = 0;
-					if ( _x > 0 ) {
-						_t += line_h[_y][_x - 1].correct + line_h[_y + 1][_x - 1].correct;
-					}
-					if ( _x < field_w - 1 ) {
-						_t += line_h[_y][_x + 1].correct + line_h[_y + 1][_x + 1].correct;
-					}
-					if ( _y > 0 ) {
-						_t += line_v[_y - 1][_x].correct + line_v[_y - 1][_x + 1].correct;
-					}
-					if ( _y < field_h - 1 ) {
-						_t += line_v[_y + 1][_x].correct + line_v[_y + 1][_x + 1].correct;
-					}
-					if ( ((_x == _sx) || (_x + 1 == _sx)) && ((_y == _sy) || (_y + 1 == _sy)) && ((_x == _ex) || (_x + 1 == _ex)) || ((_y == _ey) && (_y + 1 == _ey)) ) {
-						_t++;
-					}
+				if ( _y < _fh ) {
+					_p->side[_y][_x - 1] ^= 0x02;
 				}
-			} while ( _t > 2 );
-			if ( (_x == _x1) && (_y == _y1) ) {
-				i += 2;
+				_m = 1;
 			}
-			_x1 = _x;
-			_y1 = _y;
-
-			_len += line_h[_y][_x].correct + line_h[_y + 1][_x].correct + line_v[_y][_x].correct + line_v[_y][_x + 1].correct;
-			line_h[_y    ][_x    ].correct ^= 1;
-			line_h[_y + 1][_x    ].correct ^= 1;
-			line_v[_y    ][_x    ].correct ^= 1;
-			line_v[_y    ][_x + 1].correct ^= 1;
-			_len -= line_h[_y][_x].correct + line_h[_y + 1][_x].correct + line_v[_y][_x].correct + line_v[_y][_x + 1].correct;
-		}
-
-		if ( _ex + _ey == 1 ) {							// 左上
-			line_h[0][0].correct = 0;
-			line_v[0][0].correct = 0;
-			if ( _len > -2 ) {
-				continue;
+			else {
+				i++;
 			}
-		}
-		if ( field_w - _ex + _ey == 1 ) {				// 右上
-			line_h[0][field_w - 1].correct = 0;
-			line_v[0][field_w].correct = 0;
-			if ( _len > -2 ) {
-				continue;
+			break;
+
+		  case 1 :					// ←
+			if ( _x > 0 ) {
+				_x--;
+				if ( _y > 0 ) {						// パネル反転
+					_p->side[_y - 1][_x] ^= 0x02;
+				}
+				if ( _y < _fh ) {
+					_p->side[_y][_x] ^= 0x02;
+				}
+				_m = 0;
 			}
-		}
-		if ( _ex + field_h - _ey == 1 ) {				// 左下
-			line_h[field_h][0].correct = 0;
-			line_v[field_h - 1][0].correct = 0;
-			if ( _len > -2 ) {
-				continue;
+			else {
+				i++;
 			}
-		}
-		if ( field_w - _ex + field_h - _ey == 1 ) {		// 右下
-			line_h[field_h][field_w - 1].correct = 0;
-			line_v[field_h - 1][field_w].correct = 0;
-			if ( _len > -2 ) {
-				continue;
+			break;
+
+		  case 2 :					// ↓
+			if ( _y < _fh ) {
+				_y++;
+				if ( _x > 0 ) {						// パネル反転
+					_p->side[_y - 1][_x - 1] ^= 0x02;
+				}
+				if ( _x < _fw ) {
+					_p->side[_y - 1][_x] ^= 0x02;
+				}
+				_m = 3;
 			}
-		}
+			else {
+				i++;
+			}
+			break;
 
-		for (i = 0; i < field_h; i++) {					// パネル初期化
-			for (j = 0; j < field_w; j++) {
-				if ( !set(&panel[i][j], (bool)!(line_h[i][j].correct ^ line_h[i + 1][j].correct ^ line_v[i][j].correct ^ line_v[i][j + 1].correct)) ) {
-					_clear = false;
+		  case 3 :					// ↑
+			if ( _y > 0 ) {
+				_y--;
+				if ( _x > 0 ) {						// パネル反転
+					_p->side[_y][_x - 1] ^= 0x02;
 				}
+				if ( _x < _fw ) {
+					_p->side[_y][_x] ^= 0x02;
+				}
+				_m = 2;
+			}
+			else {
+				i++;
+			}
+			break;
+		}
+	}
+
+	_p->cursor_x = _x;									// カーソル位置（作り直すときはここから）
+	_p->cursor_y = _y;
+	for (int i = 0; i < _fh; i++) {
+		for (int j = 0; j < _fw; j++) {
+			if ( _p->side[i][j] >= 2 ) {
+				return	true;
 			}
 		}
-	} while ( _clear );
+	}
+	return	false;
+}
 
-	cursor_x = _sx;										// カーソル位置
-	cursor_y = _sy;
+/**********************************
+    問題作成の準備
+		引数	_p = 作成先
+				_level = 難易度
+ **********************************/
+static
+void	reset_puzzle(Puzzle* _p, int _level)
+{
+	_p->level = _level;
+	_p->ready = false;
+	if ( _level == 3 ) {								// フリーモードの初期位置
+		_p->cursor_x = rand() % (field_size(_level) + 1);
+		_p->cursor_y = rand() % (field_size(_level) + 1);
+	}
 }
 
+/**********************************
+    問題作成を1回進める
+		引数	_p = 作成先
+		戻り値	作成済みか
+ **********************************/
 static
-void	init_field_free(void)
+bool	step_puzzle(Puzzle* _p)
 {
-	int		_x, _y;
+	if ( !_p->ready ) {
+		_p->ready = (_p->level < 3) ? make_field(_p, _p->level) : make_field_free(_p);
+	}
+	return	_p->ready;
+}
 
-	_x = rand() % (field_w + 1);						// 初期位置
-	_y = rand() % (field_w + 1);
-	do {
-		int		_m = -1, _n;
+/**************************************************
+    次の問題を先に作る
+		クリア後・レベル選択中に選択中のレベルの問題を
+		1フレームに1回分ずつ作っておく
+ **************************************************/
+static
+void	prepare_puzzle(GameContext* _g)
+{
+	if ( _g->next_puzzle.level != _g->level ) {
+		reset_puzzle(&_g->next_puzzle, _g->level);
+	}
+	step_puzzle(&_g->next_puzzle);
+}
 
-		for (int i = 0; i < field_h; i++) {				// パネル初期化
-			for (int j = 0; j < field_w; j++) {
-				panel[i][j].side = 0;
-			}
-		}
-		for (int i = 0; i < 50; i++) {
-			do {
-				_n = rand() % 4;
-			} while ( _n == _m );
-			switch ( _n ) {
-			  case 0 :					// →
-				if ( _x < field_w ) {
-					_x++;
-					if ( _y > 0 ) {						// パネル反転
-						panel[_y - 1][_x - 1].side ^= 0x02;
-					}
-					if ( _y < field_h ) {
-						panel[_y][_x - 1].side ^= 0x02;
-					}
-					_m = 1;
-				}
-				else {
-					i++;
-				}
-				break;
+/*********************************
+    問題設定
+		引数	_level = 難易度
+ *********************************/
+static
+void	init_field(GameContext* _g, int _level)
+{
+	Puzzle*		_p = &_g->next_puzzle;
 
-			  case 1 :					// ←
-				if ( _x > 0 ) {
-					_x--;
-					if ( _y > 0 ) {						// パネル反転
-						panel[_y - 1][_x].side ^= 0x02;
-					}
-					if ( _y < field_h ) {
-						panel[_y][_x].side ^= 0x02;
-					}
-					_m = 0;
-				}
-				else {
-					i++;
-				}
-				break;
+	if ( _p->level != _level ) {						// 先に作った問題がなければここで作る
+		reset_puzzle(_p, _level);
+	}
+	while ( !step_puzzle(_p) ) ;
 
-			  case 2 :					// ↓
-				if ( _y < field_h ) {
-					_y++;
-					if ( _x > 0 ) {						// パネル反転
-						panel[_y - 1][_x - 1].side ^= 0x02;
-					}
-					if ( _x < field_w ) {
-						panel[_y - 1][_x].side ^= 0x02;
-					}
-					_m = 3;
-				}
-				else {
-					i++;
-				}
-				break;
+	if ( _level < 3 ) {
+		bool	_clear = true;
 
-			  case 3 :					// ↑
-				if ( _y > 0 ) {
-					_y--;
-					if ( _x > 0 ) {						// パネル反転
-						panel[_y][_x - 1].side ^= 0x02;
-					}
-					if ( _x < field_w ) {
-						panel[_y][_x].side ^= 0x02;
-					}
-					_m = 2;
-				}
-				else {
-					i++;
+		memcpy(_g->line_h, _p->line_h, sizeof(_g->line_h));
+		memcpy(_g->line_v, _p->line_v, sizeof(_g->line_v));
+		for (int i = 0; i < _g->field_h; i++) {				// パネル初期化
+			for (int j = 0; j < _g->field_w; j++) {
+				if ( !set(&_g->panel[i][j], (bool)!(_g->line_h[i][j].correct ^ _g->line_h[i + 1][j].correct ^ _g->line_v[i][j].correct ^ _g->line_v[i][j + 1].correct)) ) {
+					_clear = false;
 				}
-				break;
 			}
 		}
-	} while ( check_clear() );
+		if ( _clear ) {									// 揃っていたら作り直す
+			_p->ready = false;
+			init_field(_g, _level);
+			return;
+		}
+	}
+	else {
+		for (int i = 0; i < _g->field_h; i++) {				// パネル初期化
+			for (int j = 0; j < _g->field_w; j++) {
+				_g->panel[i][j].side = _p->side[i][j];
+			}
+		}
+	}
+	_g->cursor_x = _p->cursor_x;							// カーソル位置
+	_g->cursor_y = _p->cursor_y;
 
-	cursor_x = _x;										// カーソル位置
-	cursor_y = _y;
+	_p->level = -1;										// 使用済み
 }
 
-static void		set_menu(void);			// メニュー設定
+static void		set_menu(GameContext*);			// メニュー設定
+static void		remove_menu(GameContext*);		// メニュー削除
 
 /****************
     ゲーム開始
  ****************/
 static
-void	start_game(void)
+void	start_game(GameContext* _g)
 {
-	load_back();										// 背景切り替え
+	load_back(_g);										// 背景切り替え
 
-	if ( level == 0 ) {
-		field_w = field_h = 3;							// フィールドの大きさ
-		field_x = 112;									// フィールドの位置
-		field_y = 38;
+	_g->field_w = _g->field_h = field_size(_g->level);				// フィールドの大きさ
+	if ( _g->level == 0 ) {
+		_g->field_x = 112;									// フィールドの位置
+		_g->field_y = 38;
 	}
 	else {
-		field_w = field_h = 4;							// フィールドの大きさ
-		field_x = 88;									// フィールドの位置
-		field_y = 10;
+		_g->field_x = 88;									// フィールドの位置
+		_g->field_y = 10;
 	}
-	for (int i = 0; i < field_h; i++) {					// パネル初期化
-		for (int j = 0; j < field_w; j++) {
-			init_panel(&panel[i][j], field_x + PANEL_W*j, field_y + PANEL_H*i, bmp_back, bmp_base);
+	begin_pool();											// 前のレベルのビットマップを使い回す
+	for (int i = 0; i < _g->field_h; i++) {					// パネル初期化
+		for (int j = 0; j < _g->field_w; j++) {
+			init_panel(&_g->panel[i][j], _g->field_x + PANEL_W*j, _g->field_y + PANEL_H*i, _g->bmp_back, bmp_base);
 		}
 	}
+	end_pool();
+	trim_pool();											// 使い回せなかった分は解放
 
-	if ( level < 3 ) {
-		free_mode = false;
-		init_field(level);								// 問題作成
-	}
-	else {
-		free_mode = true;
-		init_field_free();								// 問題作成
+	_g->free_mode = (_g->level == 3);
+	init_field(_g, _g->level);									// 問題設定
+	_g->move_cnt		= 0;								// 移動カウンタ
+	_g->current_line	= NULL;								// 移動中のライン
+	_g->undo_cnt		= 0;								// やり直しカウンタ
+	_g->flag_answer		= false;							// 解答表示フラグ
+	_g->flag_draw		= true;								// 描画フラグ
+
+	for (int i = 0; i < _g->field_h; i++) {					// 初期状態を一度稼働させる
+		for (int j = 0; j < _g->field_w; j++) {
+			entry_anim(_g, &_g->panel[i][j]);
+		}
 	}
-	move_cnt		= 0;								// 移動カウンタ
-	current_line	= NULL;								// 移動中のライン
-	undo_cnt		= 0;								// やり直しカウンタ
-	flag_answer		= false;							// 解答表示フラグ
-	flag_draw		= true;								// 描画フラグ
 
-	set_menu();											// メニュー設定
+	set_menu(_g);											// メニュー設定
 }
 
 
-static PDMenuItem*	item_answer;
-
 /***********************
     解答例表示/非表示
  ***********************/
 static
 void	show_answer(void* _data)
 {
-	flag_answer = (bool)pd->system->getMenuItemValue(item_answer);
-	flag_draw = true;
+	GameContext*	_g = _data;
+
+	_g->flag_answer = (bool)pd->system->getMenuItemValue(_g->item_answer);
+	_g->flag_draw = true;
 }
 
 /****************
@@ -552,20 +959,36 @@ void	show_answer(void* _data)
 static
 void	give_up(void* _data)
 {
-	phase = PHASE_LEVEL + 2;
-	pd->system->removeAllMenuItems();					// メニュー削除
+	GameContext*	_g = _data;
+
+	_g->phase = PHASE_LEVEL + 2;
+	remove_menu(_g);									// メニュー削除
 }
 
 /******************
     メニュー設定
  ******************/
 static
-void	set_menu(void)
+void	set_menu(GameContext* _g)
+{
+	if ( !_g->primary ) {								// システムメニューは画面に出すゲームだけ
+		return;
+	}
+	if ( !_g->free_mode ) {
+		_g->item_answer = pd->system->addCheckmarkMenuItem("answer", 0, show_answer, _g);		// 解答例表示
+	}
+	pd->system->addMenuItem("give up", give_up, _g);										// ゲーム中止
+}
+
+/******************
+    メニュー削除
+ ******************/
+static
+void	remove_menu(GameContext* _g)
 {
-	if ( !free_mode ) {
-		item_answer = pd->system->addCheckmarkMenuItem("answer", 0, show_answer, NULL);		// 解答例表示
+	if ( _g->primary ) {
+		pd->system->removeAllMenuItems();
 	}
-	pd->system->addMenuItem("give up", give_up, NULL);										// ゲーム中止
 }
 
 /**********************************
@@ -573,13 +996,13 @@ void	set_menu(void)
 			戻り値	クリア状態か
  **********************************/
 static
-bool	check_clear(void)
+bool	check_clear(GameContext* _g)
 {
 	int		i, j;
 
-	for (i = 0; i < field_h; i++) {
-		for (j = 0; j < field_w; j++) {
-			if ( panel[i][j].side >= 2 ) {
+	for (i = 0; i < _g->field_h; i++) {
+		for (j = 0; j < _g->field_w; j++) {
+			if ( _g->panel[i][j].side >= 2 ) {
 				return	false;
 			}
 		}
@@ -588,142 +1011,211 @@ bool	check_clear(void)
 }
 
 
-static Line*	move_cursor(void);		// カーソル移動
+static Line*	move_cursor(GameContext*);		// カーソル移動
+
+/**************************************
+    待機中のフレームレート切り替え
+		引数	_g = ゲーム状態
+				_idle = 落とすか
+ **************************************/
+static
+void	set_idle_rate(GameContext* _g, bool _idle)
+{
+	if ( _g->primary && (_g->idle_rate != _idle) ) {
+		pd->display->setRefreshRate(_idle ? IDLE_RATE : FRAME_RATE);
+		_g->idle_rate = _idle;
+	}
+}
 
 /**********
     稼働
  **********/
+static void		update_main(GameContext*);		// 稼働本体
+
 void	update_game(void)
+{
+	static Button	_last;									// 前のフレームの入力
+	uint64_t		_t = begin_trace();
+
+	frame_trace();
+	if ( bench_context_cnt > 0 ) {						// 計測用のゲームも同じ入力で動かす
+		begin_bench(BENCH_STEP);						// （入力から描画までの時間に入らないよう1フレーム遅れ）
+		for (int i = 0; i < bench_context_cnt; i++) {
+			update_context(bench_context[i], &_last);
+		}
+		end_bench(BENCH_STEP);
+	}
+
+	begin_bench(BENCH_UPDATE);
+	input_bench(&button);								// 入力スクリプト
+	update_context(main_context, &button);
+	frame_memory();
+	end_bench(BENCH_UPDATE);
+	_last = button;
+	end_trace(TRACE_UPDATE, _t);
+}
+
+/**************************************
+    ゲーム1つの稼働
+		引数	_g = ゲーム状態
+				_button = ボタン入力
+ **************************************/
+void	update_context(GameContext* _g, const Button* _button)
+{
+	_g->button = *_button;
+	if ( !_g->primary ) {								// フェードはカウンタだけ進める
+		_g->fade += _g->fade_step;
+		if ( _g->fade <= 0 ) {
+			_g->fade = 0;
+		}
+		else if ( _g->fade >= 8 ) {
+			_g->fade = 8;
+		}
+	}
+	update_main(_g);
+}
+
+static
+void	update_main(GameContext* _g)
 {
 	Line*	_line = NULL;
 
-	switch ( phase ) {
+	if ( _g->button.push | _g->button.release ) {				// 入力があれば待機解除
+		set_idle_rate(_g, false);
+		_g->idle_cnt = 0;
+		_g->draw_state = -1;
+	}
+
+	switch ( _g->phase ) {
 	  case PHASE_START :				// ゲーム開始
-		phase = PHASE_GAME;
-		start_game();
-		fade_in();
-		play_bgm(BGM_GAME);
+		_g->phase = PHASE_GAME;
+		start_game(_g);
+		start_fade(_g, false);
+		play_bgm(_g, BGM_GAME);
 	  case PHASE_GAME :					// ゲーム中
-		_line = move_cursor();							// カーソル移動
+		_line = move_cursor(_g);							// カーソル移動
 		break;
 	}
-	if ( move_cnt != 0 ) {
-		flag_draw = true;
-		if ( move_cnt > 0 ) {							// 移動中
-			move_cnt--;
+	if ( _g->move_cnt != 0 ) {
+		_g->flag_draw = true;
+		if ( _g->move_cnt > 0 ) {							// 移動中
+			_g->move_cnt--;
 		}
-		else if ( move_cnt < 0 ) {
-			move_cnt++;
+		else if ( _g->move_cnt < 0 ) {
+			_g->move_cnt++;
 		}
 	}
 
-	if ( current_line && (_line || (move_cnt == 0)) ) {
-		current_line->state &= 0x01;
-		current_line = NULL;
+	if ( _g->current_line && (_line || (_g->move_cnt == 0)) ) {
+		_g->current_line->state &= 0x01;
+		_g->current_line = NULL;
 	}
 	if ( _line ) {
-		current_line = _line;
+		_g->current_line = _line;
 	}
 
-	for (int i = 0; i < field_h; i++) {					// パネル
-		for (int j = 0; j < field_w; j++) {
-			if ( update_panel(&panel[i][j]) ) {
-				flag_draw = true;
-			}
-		}
+	if ( update_anim(_g) ) {								// パネル
+		_g->flag_draw = true;
 	}
 
-	switch ( phase ) {
+	switch ( _g->phase ) {
 	  case PHASE_GAME :					// ゲーム中
-		if ( check_clear() ) {
-			phase = PHASE_CLEAR;
-			cnt = 0;
-			pd->system->removeAllMenuItems();			// メニュー削除
-			pd->sound->fileplayer->fadeVolume(bgm_player, 0.0f, 0.0f, 44100, NULL, NULL);			// BGMフェードアウト
+		if ( check_clear(_g) ) {
+			_g->phase = PHASE_CLEAR;
+			_g->cnt = 0;
+			remove_menu(_g);							// メニュー削除
+			fade_bgm(_g, 44100);						// BGMフェードアウト
 		}
 		break;
 
 	  case PHASE_CLEAR :				// クリア
-		if ( ++cnt == 15 ) {
-			play_se(SE_CLEAR);
+		if ( ++_g->cnt == 15 ) {
+			play_se(_g, SE_CLEAR);
 		}
-		if ( (cnt > 30) && (button.trigger & (kButtonA | kButtonB)) ) {
-			phase = PHASE_LEVEL + 1;
-			play_se(SE_CLICK);
-			play_bgm(BGM_MENU);
+		if ( (_g->cnt > 30) && (_g->button.trigger & (kButtonA | kButtonB)) ) {
+			_g->phase = PHASE_LEVEL + 1;
+			play_se(_g, SE_CLICK);
+			play_bgm(_g, BGM_MENU);
 		}
 		break;
 
 	  case PHASE_LEVEL + 2 :			// レベル選択（ゲーム中）
-		if ( button.trigger & kButtonB ) {				// ゲームに戻る
-			phase = PHASE_GAME;
-			play_se(SE_BACK);
-			set_menu();									// メニュー設定
+		if ( _g->button.trigger & kButtonB ) {				// ゲームに戻る
+			_g->phase = PHASE_GAME;
+			play_se(_g, SE_BACK);
+			set_menu(_g);									// メニュー設定
 			break;
 		}
 	  case PHASE_LEVEL + 0 :			// レベル選択（タイトル後）
 	  case PHASE_LEVEL + 1 :			// レベル選択（クリア後）
-		if ( (button.repeat & kButtonUp) && (level > 0) ) {
-			level--;
-			play_se(SE_FORWARD);
-		}
-		else if ( (button.repeat & kButtonDown) && (level < 4 - 1) ) {
-			level++;
-			play_se(SE_FORWARD);
-		}
-		if ( button.trigger & kButtonA ) {
-			play_se(SE_CLICK);
-			pd->sound->fileplayer->fadeVolume(bgm_player, 0.0f, 0.0f, 44100*7/30, NULL, NULL);		// BGMフェードアウト
-			fade_out();									// 画面フェードアウト
-		}
-		if ( fade_cnt >= 8 ) {
-			if ( phase > PHASE_LEVEL + 0 ) {
-				for (int i = 0; i < field_h; i++) {		// パネル解放
-					for (int j = 0; j < field_w; j++) {
-						quit_panel(&panel[i][j]);
+		if ( (_g->button.repeat & kButtonUp) && (_g->level > 0) ) {
+			_g->level--;
+			play_se(_g, SE_FORWARD);
+		}
+		else if ( (_g->button.repeat & kButtonDown) && (_g->level < 4 - 1) ) {
+			_g->level++;
+			play_se(_g, SE_FORWARD);
+		}
+		if ( _g->button.trigger & kButtonA ) {
+			play_se(_g, SE_CLICK);
+			fade_bgm(_g, 44100*7/30);					// BGMフェードアウト
+			start_fade(_g, true);						// 画面フェードアウト
+		}
+		if ( get_fade(_g) >= 8 ) {
+			if ( _g->phase > PHASE_LEVEL + 0 ) {
+				begin_pool();							// ビットマップは次のレベル用に取っておく
+				for (int i = 0; i < _g->field_h; i++) {		// パネル解放
+					for (int j = 0; j < _g->field_w; j++) {
+						quit_panel(&_g->panel[i][j]);
 					}
 				}
+				end_pool();
+				clear_anim(_g);
 			}
-			phase = PHASE_START;
+			_g->phase = PHASE_START;
 		}
 		break;
 
 	  case PHASE_TITLE :				// タイトル
-		cnt++;
-		if ( button.trigger & (kButtonA | kButtonB) ) {
-			phase = PHASE_LEVEL + 0;
-			play_se(SE_CLICK);
+		_g->cnt++;
+		if ( _g->button.trigger & (kButtonA | kButtonB) ) {
+			_g->phase = PHASE_LEVEL + 0;
+			play_se(_g, SE_CLICK);
 		}
 		break;
 	}
+
+	if ( (_g->phase == PHASE_CLEAR) || ((_g->phase >= PHASE_LEVEL) && (_g->phase < PHASE_START)) ) {
+		prepare_puzzle(_g);								// 次の問題を先に作る
+	}
 }
 
-static bool		check_point(int, int);	// 移動チェック
+static bool		check_point(GameContext*, int, int);	// 移動チェック
 
 /********************************
     カーソル移動
 		戻り値	移動中のライン
  ********************************/
 static
-Line*	move_cursor(void)
+Line*	move_cursor(GameContext* _g)
 {
 	Line*		_line = NULL;
 	PDButtons	_btn = 0;
 
-	if ( (button.repeat & kButtonRight) && (cursor_x < field_w) ) {					// →
+	if ( (_g->button.repeat & kButtonRight) && (_g->cursor_x < _g->field_w) ) {					// →
 		_btn = kButtonRight;
 	}
-	else if ( (button.repeat & kButtonLeft) && (cursor_x > 0) ) {					// ←
+	else if ( (_g->button.repeat & kButtonLeft) && (_g->cursor_x > 0) ) {					// ←
 		_btn = kButtonLeft;
 	}
-	else if ( (button.repeat & kButtonDown) && (cursor_y < field_h) ) {				// ↓
+	else if ( (_g->button.repeat & kButtonDown) && (_g->cursor_y < _g->field_h) ) {				// ↓
 		_btn = kButtonDown;
 	}
-	else if ( (button.repeat & kButtonUp) && (cursor_y > 0) ) {						// ↑
+	else if ( (_g->button.repeat & kButtonUp) && (_g->cursor_y > 0) ) {						// ↑
 		_btn = kButtonUp;
 	}
-	else if ( (button.repeat & kButtonB) && (undo_cnt > 0) && !free_mode ) {		// やり直し
-		switch ( undo[undo_cnt - 1] ) {
+	else if ( (_g->button.repeat & kButtonB) && (_g->undo_cnt > 0) && !_g->free_mode ) {		// やり直し
+		switch ( _g->undo[_g->undo_cnt - 1] ) {
 		  case kButtonRight :
 			_btn = kButtonLeft;
 			break;
@@ -741,142 +1233,142 @@ Line*	move_cursor(void)
 
 	switch ( _btn ) {
 	  case kButtonRight :				// →
-		_line = &line_h[cursor_y][cursor_x];
-		cursor_dx = 1;
-		cursor_dy = 0;
-		if ( free_mode ) {
-			play_se(SE_FORWARD);
+		_line = &_g->line_h[_g->cursor_y][_g->cursor_x];
+		_g->cursor_dx = 1;
+		_g->cursor_dy = 0;
+		if ( _g->free_mode ) {
+			play_se(_g, SE_FORWARD);
 		}
-		else if ( check_point(cursor_x + 1, cursor_y) ) {
+		else if ( check_point(_g, _g->cursor_x + 1, _g->cursor_y) ) {
 			_line->state = 0x11;
-			undo[undo_cnt++] = kButtonRight;
-			play_se(SE_FORWARD);
+			_g->undo[_g->undo_cnt++] = kButtonRight;
+			play_se(_g, SE_FORWARD);
 		}
-		else if ( (undo_cnt > 0) && (undo[undo_cnt - 1] == kButtonLeft) ) {		// やり直し
+		else if ( (_g->undo_cnt > 0) && (_g->undo[_g->undo_cnt - 1] == kButtonLeft) ) {		// やり直し
 			_line->state = 0x10;
-			undo_cnt--;
-			play_se(SE_BACK);
+			_g->undo_cnt--;
+			play_se(_g, SE_BACK);
 		}
-		else if ( button.trigger & kButtonRight ) {
-			move_cnt = -6;
-			play_se(SE_STOP);
+		else if ( _g->button.trigger & kButtonRight ) {
+			_g->move_cnt = -STOP_TIME;
+			play_se(_g, SE_STOP);
 			return	_line;
 		}
 		else {
 			return	NULL;
 		}
-		cursor_x++;
-		move_cnt = 8;
-		if ( cursor_y > 0 ) {							// パネル反転
-			reverse_h(&panel[cursor_y - 1][cursor_x - 1]);
+		_g->cursor_x++;
+		_g->move_cnt = MOVE_TIME;
+		if ( _g->cursor_y > 0 ) {							// パネル反転
+			flip_h(_g, &_g->panel[_g->cursor_y - 1][_g->cursor_x - 1]);
 		}
-		if ( cursor_y < field_h ) {
-			reverse_h(&panel[cursor_y][cursor_x - 1]);
+		if ( _g->cursor_y < _g->field_h ) {
+			flip_h(_g, &_g->panel[_g->cursor_y][_g->cursor_x - 1]);
 		}
 		break;
 
 	  case kButtonLeft :				// ←
-		_line = &line_h[cursor_y][cursor_x - 1];
-		cursor_dx = -1;
-		cursor_dy = 0;
-		if ( free_mode ) {
-			play_se(SE_FORWARD);
+		_line = &_g->line_h[_g->cursor_y][_g->cursor_x - 1];
+		_g->cursor_dx = -1;
+		_g->cursor_dy = 0;
+		if ( _g->free_mode ) {
+			play_se(_g, SE_FORWARD);
 		}
-		else if ( check_point(cursor_x - 1, cursor_y) ) {
+		else if ( check_point(_g, _g->cursor_x - 1, _g->cursor_y) ) {
 			_line->state = 0x21;
-			undo[undo_cnt++] = kButtonLeft;
-			play_se(SE_FORWARD);
+			_g->undo[_g->undo_cnt++] = kButtonLeft;
+			play_se(_g, SE_FORWARD);
 		}
-		else if ( (undo_cnt > 0) && (undo[undo_cnt - 1] == kButtonRight) ) {	// やり直し
+		else if ( (_g->undo_cnt > 0) && (_g->undo[_g->undo_cnt - 1] == kButtonRight) ) {	// やり直し
 			_line->state = 0x20;
-			undo_cnt--;
-			play_se(SE_BACK);
+			_g->undo_cnt--;
+			play_se(_g, SE_BACK);
 		}
-		else if ( button.trigger & kButtonLeft ) {
-			move_cnt = -6;
-			play_se(SE_STOP);
+		else if ( _g->button.trigger & kButtonLeft ) {
+			_g->move_cnt = -STOP_TIME;
+			play_se(_g, SE_STOP);
 			return	_line;
 		}
 		else {
 			return	NULL;
 		}
-		cursor_x--;
-		move_cnt = 8;
-		if ( cursor_y > 0 ) {							// パネル反転
-			reverse_h(&panel[cursor_y - 1][cursor_x]);
+		_g->cursor_x--;
+		_g->move_cnt = MOVE_TIME;
+		if ( _g->cursor_y > 0 ) {							// パネル反転
+			flip_h(_g, &_g->panel[_g->cursor_y - 1][_g->cursor_x]);
 		}
-		if ( cursor_y < field_h ) {
-			reverse_h(&panel[cursor_y][cursor_x]);
+		if ( _g->cursor_y < _g->field_h ) {
+			flip_h(_g, &_g->panel[_g->cursor_y][_g->cursor_x]);
 		}
 		break;
 
 	  case kButtonDown :				// ↓
-		_line = &line_v[cursor_y][cursor_x];
-		cursor_dx = 0;
-		cursor_dy = 1;
-		if ( free_mode ) {
-			play_se(SE_FORWARD);
+		_line = &_g->line_v[_g->cursor_y][_g->cursor_x];
+		_g->cursor_dx = 0;
+		_g->cursor_dy = 1;
+		if ( _g->free_mode ) {
+			play_se(_g, SE_FORWARD);
 		}
-		else if ( check_point(cursor_x, cursor_y + 1) ) {
+		else if ( check_point(_g, _g->cursor_x, _g->cursor_y + 1) ) {
 			_line->state = 0x11;
-			undo[undo_cnt++] = kButtonDown;
-			play_se(SE_FORWARD);
+			_g->undo[_g->undo_cnt++] = kButtonDown;
+			play_se(_g, SE_FORWARD);
 		}
-		else if ( (undo_cnt > 0) && (undo[undo_cnt - 1] == kButtonUp) ) {		// やり直し
+		else if ( (_g->undo_cnt > 0) && (_g->undo[_g->undo_cnt - 1] == kButtonUp) ) {		// やり直し
 			_line->state = 0x10;
-			undo_cnt--;
-			play_se(SE_BACK);
+			_g->undo_cnt--;
+			play_se(_g, SE_BACK);
 		}
-		else if ( button.trigger & kButtonDown ) {
-			move_cnt = -6;
-			play_se(SE_STOP);
+		else if ( _g->button.trigger & kButtonDown ) {
+			_g->move_cnt = -STOP_TIME;
+			play_se(_g, SE_STOP);
 			return	_line;
 		}
 		else {
 			return	NULL;
 		}
-		cursor_y++;
-		move_cnt = 8;
-		if ( cursor_x > 0 ) {							// パネル反転
-			reverse_v(&panel[cursor_y - 1][cursor_x - 1]);
+		_g->cursor_y++;
+		_g->move_cnt = MOVE_TIME;
+		if ( _g->cursor_x > 0 ) {							// パネル反転
+			flip_v(_g, &_g->panel[_g->cursor_y - 1][_g->cursor_x - 1]);
 		}
-		if ( cursor_x < field_w ) {
-			reverse_v(&panel[cursor_y - 1][cursor_x]);
+		if ( _g->cursor_x < _g->field_w ) {
+			flip_v(_g, &_g->panel[_g->cursor_y - 1][_g->cursor_x]);
 		}
 		break;
 
 	  case kButtonUp :					// ↑
-		_line = &line_v[cursor_y - 1][cursor_x];
-		cursor_dx = 0;
-		cursor_dy = -1;
-		if ( free_mode ) {
-			play_se(SE_FORWARD);
+		_line = &_g->line_v[_g->cursor_y - 1][_g->cursor_x];
+		_g->cursor_dx = 0;
+		_g->cursor_dy = -1;
+		if ( _g->free_mode ) {
+			play_se(_g, SE_FORWARD);
 		}
-		else if ( check_point(cursor_x, cursor_y - 1) ) {
+		else if ( check_point(_g, _g->cursor_x, _g->cursor_y - 1) ) {
 			_line->state = 0x21;
-			undo[undo_cnt++] = kButtonUp;
-			play_se(SE_FORWARD);
+			_g->undo[_g->undo_cnt++] = kButtonUp;
+			play_se(_g, SE_FORWARD);
 		}
-		else if ( (undo_cnt > 0) && (undo[undo_cnt - 1] == kButtonDown) ) {		// やり直し
+		else if ( (_g->undo_cnt > 0) && (_g->undo[_g->undo_cnt - 1] == kButtonDown) ) {		// やり直し
 			_line->state = 0x20;
-			undo_cnt--;
-			play_se(SE_BACK);
+			_g->undo_cnt--;
+			play_se(_g, SE_BACK);
 		}
-		else if ( button.trigger & kButtonUp ) {
-			move_cnt = -6;
-			play_se(SE_STOP);
+		else if ( _g->button.trigger & kButtonUp ) {
+			_g->move_cnt = -STOP_TIME;
+			play_se(_g, SE_STOP);
 			return	_line;
 		}
 		else {
 			return	NULL;
 		}
-		cursor_y--;
-		move_cnt = 8;
-		if ( cursor_x > 0 ) {							// パネル反転
-			reverse_v(&panel[cursor_y][cursor_x - 1]);
+		_g->cursor_y--;
+		_g->move_cnt = MOVE_TIME;
+		if ( _g->cursor_x > 0 ) {							// パネル反転
+			flip_v(_g, &_g->panel[_g->cursor_y][_g->cursor_x - 1]);
 		}
-		if ( cursor_x < field_w ) {
-			reverse_v(&panel[cursor_y][cursor_x]);
+		if ( _g->cursor_x < _g->field_w ) {
+			flip_v(_g, &_g->panel[_g->cursor_y][_g->cursor_x]);
 		}
 		break;
 	}
@@ -887,76 +1379,150 @@ Line*	move_cursor(void)
 	移動チェック
  ******************/
 static
-bool	check_point(int _x, int _y)
+bool	check_point(GameContext* _g, int _x, int _y)
 {
-	return	(((_x == 0) || !(line_h[_y][_x - 1].state & 0x01)) && ((_y == 0) || !(line_v[_y - 1][_x].state & 0x01))
-				&& ((_x == field_w) || !(line_h[_y][_x].state & 0x01)) && ((_y == field_h) || !(line_v[_y][_x].state & 0x01)));
+	return	(((_x == 0) || !(_g->line_h[_y][_x - 1].state & 0x01)) && ((_y == 0) || !(_g->line_v[_y - 1][_x].state & 0x01))
+				&& ((_x == _g->field_w) || !(_g->line_h[_y][_x].state & 0x01)) && ((_y == _g->field_h) || !(_g->line_v[_y][_x].state & 0x01)));
 }
 
 
-static void		draw_panels(void);		// パネル描画
-static void		draw_lines(void);		// ライン描画
-static void		draw_answer(void);		// 解答描画
-static void		draw_cursor(void);		// カーソル描画
-static void		draw_clear(void);		// クリア描画
-static void		draw_level(void);		// レベル選択画面描画
-static void		draw_title(void);		// タイトル描画
+static void		draw_panels(GameContext*);		// パネル描画
+static void		draw_lines(GameContext*);		// ライン描画
+static void		draw_answer(GameContext*);		// 解答描画
+static void		draw_cursor(GameContext*);		// カーソル描画
+static void		draw_clear(GameContext*);		// クリア描画
+static void		draw_level(GameContext*);		// レベル選択画面描画
+static void		draw_title(GameContext*);		// タイトル描画
+
+/********************************************************
+    表示状態取得
+		戻り値	表示状態（前回と同じなら画面に変化なし）
+				-1 = アニメーション中
+ ********************************************************/
+static
+int		get_draw_state(GameContext* _g)
+{
+	if ( get_fade(_g) != 0 ) {								// フェード中
+		return	-1;
+	}
+	switch ( _g->phase ) {
+	  case PHASE_LEVEL + 0 :
+	  case PHASE_LEVEL + 1 :
+	  case PHASE_LEVEL + 2 :
+		return	_g->level;									// レベル選択
+
+	  case PHASE_TITLE :
+		for (int i = 0; i < 6; i++) {					// ロゴ回転中
+			if ( (_g->cnt + 200 - i*12) % 200 < LOGO_TIME ) {
+				return	-1;
+			}
+		}
+		return	4;
+
+	  case PHASE_GAME :
+		if ( (_g->anim_cnt == 0) && (_g->move_cnt == 0) ) {		// 止まっていればカーソルのコマと位置だけ
+			return	5 + (common_counter % 8)/2 + 4*(_g->cursor_y*(FIELD_W + 1) + _g->cursor_x);
+		}
+		return	-1;
+	}
+	return	-1;											// "CLEAR!" は常に動いている
+}
+
+static bool		draw_main(GameContext*);		// 描画本体
 
 /**********
     描画
  **********/
 void	draw_game(void)
 {
-	if ( flag_draw ) {
-		gfx->pushContext(bmp_game);								// ゲーム画面バッファ
-		gfx->drawBitmap(bmp_back, 0, 0, kBitmapUnflipped);		// 背景
-		draw_panels();											// パネル
-		if ( flag_answer ) {
-			draw_answer();										// 解答例
+	uint64_t	_t = begin_trace();
+
+	begin_bench(BENCH_DRAW);
+	draw_context(main_context);
+	if ( end_bench(BENCH_DRAW) ) {						// 計測終了
+		end_trace(TRACE_DRAW, _t);
+		quit_game();
+		exit(0);
+	}
+	end_trace(TRACE_DRAW, _t);
+}
+
+/**************************************
+    ゲーム1つの描画
+		引数	_g = ゲーム状態
+		戻り値	描画したか（前回と同じ画面なら描かない）
+ **************************************/
+bool	draw_context(GameContext* _g)
+{
+	return	draw_main(_g);
+}
+
+static
+bool	draw_main(GameContext* _g)
+{
+	int		_state = get_draw_state(_g);
+
+	if ( !_g->flag_draw && (_state >= 0) && (_state == _g->draw_state) ) {		// 前回と同じ画面
+		if ( (++_g->idle_cnt == IDLE_WAIT) && (_g->phase != PHASE_TITLE) ) {	// 待機中はフレームレートを落とす
+			set_idle_rate(_g, true);								// （タイトルのロゴはフレーム数で回るので落とさない）
 		}
-		if ( !free_mode ) {
-			draw_lines();										// ライン
+		return	false;
+	}
+	set_idle_rate(_g, false);
+	_g->idle_cnt = 0;
+	_g->draw_state = _state;
+
+	if ( _g->flag_draw ) {
+		gfx->pushContext(_g->bmp_game);								// ゲーム画面バッファ
+		gfx->drawBitmap(_g->bmp_back, 0, 0, kBitmapUnflipped);		// 背景
+		draw_panels(_g);											// パネル
+		if ( _g->flag_answer ) {
+			draw_answer(_g);										// 解答例
+		}
+		if ( !_g->free_mode ) {
+			draw_lines(_g);										// ライン
 		}
 		gfx->popContext();
-		flag_draw = false;
+		_g->flag_draw = false;
 	}
-	gfx->drawBitmap(bmp_game, 0, 0, kBitmapUnflipped);
+	gfx->drawBitmap(_g->bmp_game, 0, 0, kBitmapUnflipped);
 
-	switch ( phase ) {
+	switch ( _g->phase ) {
 	  case PHASE_LEVEL + 0 :
 	  case PHASE_LEVEL + 1 :
 	  case PHASE_LEVEL + 2 :
-		draw_level();									// レベル選択
+		draw_level(_g);									// レベル選択
 		break;
 
 	  case PHASE_TITLE :
-		draw_title();									// タイトル
+		draw_title(_g);									// タイトル
 		break;
 
 	  case PHASE_CLEAR :
-		draw_clear();									// "CLEAR!"
-		if ( cnt > 30 ) {
+		draw_clear(_g);									// "CLEAR!"
+		if ( _g->cnt > 30 ) {
 			break;
 		}
 	  case PHASE_GAME :
-		draw_cursor();									// カーソル
+		draw_cursor(_g);									// カーソル
 		break;
 	}
 
 //	pd->system->drawFPS(0,0);
+	return	true;
 }
 
 /****************
     パネル描画
  ****************/
 static
-void	draw_panels(void)
+void	draw_panels(GameContext* _g)
 {
 	int		i, j;
 
-	for (i = 0; i < field_h; i++) {
-		for (j = 0; j < field_w; j++) {
-			draw_panel(&panel[i][j]);
+	for (i = 0; i < _g->field_h; i++) {
+		for (j = 0; j < _g->field_w; j++) {
+			draw_panel(&_g->panel[i][j]);
 		}
 	}
 }
@@ -965,95 +1531,95 @@ void	draw_panels(void)
     ライン描画
  ****************/
 static
-void	draw_lines(void)
+void	draw_lines(GameContext* _g)
 {
 	int		i, j, _t;
 
-	_t = move_cnt*move_cnt*PANEL_W/(8*8);
+	_t = scale_curve(CURVE_MOVE, abs(_g->move_cnt), PANEL_W);
 	for (i = 0; i < FIELD_H + 1; i++) {					// 横ライン
 		for (j = 0; j < FIELD_W; j++) {
-			switch ( line_h[i][j].state ) {
+			switch ( _g->line_h[i][j].state ) {
 			  case 0x01 :
-				gfx->fillRect(field_x + j*PANEL_W - 3, field_y + i*PANEL_H - 3, PANEL_W + 6, 6, kColorWhite);
+				gfx->fillRect(_g->field_x + j*PANEL_W - 3, _g->field_y + i*PANEL_H - 3, PANEL_W + 6, 6, kColorWhite);
 				break;
 
 			  case 0x20 :
 				_t = PANEL_W - _t;
 			  case 0x11 :
-				gfx->fillRect(field_x + j*PANEL_W - 3, field_y + i*PANEL_H - 3, PANEL_W + 6 - _t, 6, kColorWhite);
+				gfx->fillRect(_g->field_x + j*PANEL_W - 3, _g->field_y + i*PANEL_H - 3, PANEL_W + 6 - _t, 6, kColorWhite);
 				break;
 
 			  case 0x10 :
 				_t = PANEL_W - _t;
 			  case 0x21 :
-				gfx->fillRect(field_x + j*PANEL_W - 3 + _t, field_y + i*PANEL_H - 3, PANEL_W + 6 - _t, 6, kColorWhite);
+				gfx->fillRect(_g->field_x + j*PANEL_W - 3 + _t, _g->field_y + i*PANEL_H - 3, PANEL_W + 6 - _t, 6, kColorWhite);
 				break;
 			}
 		}
 	}
-	_t = move_cnt*move_cnt*PANEL_H/(8*8);
+	_t = scale_curve(CURVE_MOVE, abs(_g->move_cnt), PANEL_H);
 	for (i = 0; i < FIELD_H; i++) {						// 縦ライン
 		for (j = 0; j < FIELD_W + 1; j++) {
-			switch ( line_v[i][j].state ) {
+			switch ( _g->line_v[i][j].state ) {
 			  case 0x01 :
-				gfx->fillRect(field_x + j*PANEL_W - 3, field_y + i*PANEL_H - 3, 6, PANEL_H + 6, kColorWhite);
+				gfx->fillRect(_g->field_x + j*PANEL_W - 3, _g->field_y + i*PANEL_H - 3, 6, PANEL_H + 6, kColorWhite);
 				break;
 
 			  case 0x20 :
 				_t = PANEL_H - _t;
 			  case 0x11 :
-				gfx->fillRect(field_x + j*PANEL_W - 3, field_y + i*PANEL_H - 3, 6, PANEL_H + 6 - _t, kColorWhite);
+				gfx->fillRect(_g->field_x + j*PANEL_W - 3, _g->field_y + i*PANEL_H - 3, 6, PANEL_H + 6 - _t, kColorWhite);
 				break;
 
 			  case 0x10 :
 				_t = PANEL_H - _t;
 			  case 0x21 :
-				gfx->fillRect(field_x + j*PANEL_W - 3, field_y + i*PANEL_H - 3 + _t, 6, PANEL_H + 6 - _t, kColorWhite);
+				gfx->fillRect(_g->field_x + j*PANEL_W - 3, _g->field_y + i*PANEL_H - 3 + _t, 6, PANEL_H + 6 - _t, kColorWhite);
 				break;
 			}
 		}
 	}
 
-	_t = move_cnt*move_cnt*PANEL_W/(8*8);
+	_t = scale_curve(CURVE_MOVE, abs(_g->move_cnt), PANEL_W);
 	for (i = 0; i < FIELD_H + 1; i++) {					// 横ライン
 		for (j = 0; j < FIELD_W; j++) {
-			switch ( line_h[i][j].state ) {
+			switch ( _g->line_h[i][j].state ) {
 			  case 0x01 :
-				gfx->fillRect(field_x + j*PANEL_W - 2, field_y + i*PANEL_H - 2, PANEL_W + 4, 4, kColorBlack);
+				gfx->fillRect(_g->field_x + j*PANEL_W - 2, _g->field_y + i*PANEL_H - 2, PANEL_W + 4, 4, kColorBlack);
 				break;
 
 			  case 0x20 :
 				_t = PANEL_W - _t;
 			  case 0x11 :
-				gfx->fillRect(field_x + j*PANEL_W - 2, field_y + i*PANEL_H - 2, PANEL_W + 4 - _t, 4, kColorBlack);
+				gfx->fillRect(_g->field_x + j*PANEL_W - 2, _g->field_y + i*PANEL_H - 2, PANEL_W + 4 - _t, 4, kColorBlack);
 				break;
 
 			  case 0x10 :
 				_t = PANEL_W - _t;
 			  case 0x21 :
-				gfx->fillRect(field_x + j*PANEL_W - 2 + _t, field_y + i*PANEL_H - 2, PANEL_W + 4 - _t, 4, kColorBlack);
+				gfx->fillRect(_g->field_x + j*PANEL_W - 2 + _t, _g->field_y + i*PANEL_H - 2, PANEL_W + 4 - _t, 4, kColorBlack);
 				break;
 			}
 		}
 	}
-	_t = move_cnt*move_cnt*PANEL_H/(8*8);
+	_t = scale_curve(CURVE_MOVE, abs(_g->move_cnt), PANEL_H);
 	for (i = 0; i < FIELD_H; i++) {						// 縦ライン
 		for (j = 0; j < FIELD_W + 1; j++) {
-			switch ( line_v[i][j].state ) {
+			switch ( _g->line_v[i][j].state ) {
 			  case 0x01 :
-				gfx->fillRect(field_x + j*PANEL_W - 2, field_y + i*PANEL_H - 2, 4, PANEL_H + 4, kColorBlack);
+				gfx->fillRect(_g->field_x + j*PANEL_W - 2, _g->field_y + i*PANEL_H - 2, 4, PANEL_H + 4, kColorBlack);
 				break;
 
 			  case 0x20 :
 				_t = PANEL_H - _t;
 			  case 0x11 :
-				gfx->fillRect(field_x + j*PANEL_W - 2, field_y + i*PANEL_H - 2, 4, PANEL_H + 4 - _t, kColorBlack);
+				gfx->fillRect(_g->field_x + j*PANEL_W - 2, _g->field_y + i*PANEL_H - 2, 4, PANEL_H + 4 - _t, kColorBlack);
 				break;
 
 			  case 0x10 :
 				_t = PANEL_H - _t;
 			  case 0x21 :
-				gfx->fillRect(field_x + j*PANEL_W - 2, field_y + i*PANEL_H - 2 + _t, 4, PANEL_H + 4 - _t, kColorBlack);
+				gfx->fillRect(_g->field_x + j*PANEL_W - 2, _g->field_y + i*PANEL_H - 2 + _t, 4, PANEL_H + 4 - _t, kColorBlack);
 				break;
 			}
 		}
@@ -1064,22 +1630,22 @@ void	draw_lines(void)
     解答描画
  **************/
 static
-void	draw_answer(void)
+void	draw_answer(GameContext* _g)
 {
 	LCDSolidColor	_color = kColorBlack;
 	int		i, j;
 
 	for (i = 0; i < FIELD_H + 1; i++) {					// 横ライン
 		for (j = 0; j < FIELD_W; j++) {
-			if ( line_h[i][j].correct && (line_h[i][j].state != 0x01) ) {
-				gfx->fillRect(field_x + j*PANEL_W - 1, field_y + i*PANEL_H - 1, PANEL_W + 2, 2, _color);
+			if ( _g->line_h[i][j].correct && (_g->line_h[i][j].state != 0x01) ) {
+				gfx->fillRect(_g->field_x + j*PANEL_W - 1, _g->field_y + i*PANEL_H - 1, PANEL_W + 2, 2, _color);
 			}
 		}
 	}
 	for (i = 0; i < FIELD_H; i++) {						// 縦ライン
 		for (j = 0; j < FIELD_W + 1; j++) {
-			if ( line_v[i][j].correct && (line_v[i][j].state != 0x01) ) {
-				gfx->fillRect(field_x + j*PANEL_W - 1, field_y + i*PANEL_H - 1, 2, PANEL_H + 2, _color);
+			if ( _g->line_v[i][j].correct && (_g->line_v[i][j].state != 0x01) ) {
+				gfx->fillRect(_g->field_x + j*PANEL_W - 1, _g->field_y + i*PANEL_H - 1, 2, PANEL_H + 2, _color);
 			}
 		}
 	}
@@ -1089,18 +1655,18 @@ void	draw_answer(void)
     カーソル描画
  ******************/
 static
-void	draw_cursor(void)
+void	draw_cursor(GameContext* _g)
 {
-	int		_x = field_x + cursor_x*PANEL_W - 16,
-			_y = field_y + cursor_y*PANEL_H - 16;
+	int		_x = _g->field_x + _g->cursor_x*PANEL_W - 16,
+			_y = _g->field_y + _g->cursor_y*PANEL_H - 16;
 
-	if ( move_cnt > 0 ) {								// 移動中
-		_x -= cursor_dx*move_cnt*move_cnt*PANEL_W/(8*8);
-		_y -= cursor_dy*move_cnt*move_cnt*PANEL_H/(8*8);
+	if ( _g->move_cnt > 0 ) {								// 移動中
+		_x -= _g->cursor_dx*scale_curve(CURVE_MOVE, _g->move_cnt, PANEL_W);
+		_y -= _g->cursor_dy*scale_curve(CURVE_MOVE, _g->move_cnt, PANEL_H);
 	}
-	else if ( move_cnt < 0 ) {							// 移動不可
-		_x += cursor_dx*(3*3 - (3 + move_cnt)*(3 + move_cnt))*PANEL_W/(3*3*3);
-		_y += cursor_dy*(3*3 - (3 + move_cnt)*(3 + move_cnt))*PANEL_H/(3*3*3);
+	else if ( _g->move_cnt < 0 ) {							// 移動不可
+		_x += _g->cursor_dx*scale_curve(CURVE_STOP, -_g->move_cnt, PANEL_W);
+		_y += _g->cursor_dy*scale_curve(CURVE_STOP, -_g->move_cnt, PANEL_H);
 	}
 	gfx->drawBitmap(bmp_cursor[(common_counter % 8)/2], _x, _y, kBitmapUnflipped);
 }
@@ -1109,13 +1675,13 @@ void	draw_cursor(void)
     クリア描画
  ****************/
 static
-void	draw_clear(void)
+void	draw_clear(GameContext* _g)
 {
 	int		_t;
 
 	for (int i = 0, _x = 112; i < 176/8; i++, _x += 8) {
-		_t = cnt - i;
-		gfx->drawBitmap(bmp_clear[i], _x, (_t < 40) ? (100 - (_t - 40)*(_t - 40)/3) : (96 + (int)(cosf(((_t - 40) % 48)*(M_PI*2/48))*4.0f)), kBitmapUnflipped);
+		_t = _g->cnt - i;
+		gfx->drawBitmap(bmp_clear[i], _x, (_t < 40) ? (100 - (_t - 40)*(_t - 40)/3) : (96 + scale_curve(CURVE_WAVE, _t - 40, 4)), kBitmapUnflipped);
 	}
 }
 
@@ -1123,31 +1689,16 @@ void	draw_clear(void)
     レベル選択画面描画
  ************************/
 static
-void	draw_level(void)
+void	draw_level(GameContext* _g)
 {
-	static const
-	int		item_y[] = {72, 108, 144, 184};
-
-	gfx->drawBitmap(bmp_board, 120, 40, kBitmapUnflipped);							// 背景
-	for (int i = 0; i < 4; i++) {
-		if ( i == level ) {								// 選択中
-			gfx->setDrawMode(kDrawModeWhiteTransparent);
-			gfx->drawBitmap(bmp_select, 136, item_y[i] - 16, kBitmapUnflipped);		// 下地
-			gfx->setDrawMode(kDrawModeInverted);
-		}
-		else {
-			gfx->setDrawMode(kDrawModeWhiteTransparent);
-		}
-		gfx->drawBitmap(bmp_level[i], 160, item_y[i] - 12, kBitmapUnflipped);		// レベル
-	}
-	gfx->setDrawMode(kDrawModeCopy);
+	gfx->drawBitmap(bmp_menu[_g->level], 120, 40, kBitmapUnflipped);
 }
 
 /******************
     タイトル描画
  ******************/
 static
-void	draw_title(void)
+void	draw_title(GameContext* _g)
 {
 	static const
 	int		param[][3] =
@@ -1162,13 +1713,13 @@ void	draw_title(void)
 
 	const int*	p = &param[0][0];
 	for (int i = 0; i < 6; i++) {
-		int		_t = (cnt + 200 - i*12) % 200;
+		int		_t = (_g->cnt + 200 - i*12) % 200;
 
-		if ( _t >= 20 ) {
+		if ( _t >= LOGO_TIME ) {
 			gfx->drawBitmap(bmp_logo[p[0]], p[1], p[2], kBitmapUnflipped);
 		}
 		else {
-			float	_scl = cosf(_t*M_PI/10);
+			float	_scl = (float)get_curve(CURVE_LOGO, _t)/CURVE_ONE;
 			if ( i % 2 == 0 ) {
 				gfx->drawScaledBitmap(bmp_logo[p[0]], p[1] + 28 - (int)(_scl*((_scl > 0.0f) ? 28 : -28)), p[2], _scl, 1.0f);
 			}
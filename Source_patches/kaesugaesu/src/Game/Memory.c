@@ -0,0 +1,254 @@
+﻿
+/*
+ *  メモリ使用量の記録
+ *
+ *  ゲームが確保するビットマップ・SE データ・サウンドプレイヤーを種類別に
+ *  記録し、使用中のバイト数・最大バイト数・フレームあたりの確保回数を数える。
+ *  環境変数 MEM_REPORT が設定されていれば、quit_game の最後に結果と
+ *  解放されずに残っているものの一覧を表示する（長時間動かしたときの
+ *  メモリの増え方を調べるためのもの）。設定されていなければ何も記録しない。
+ *
+ *  API の中で確保されるもの（Panel.c のパネルや SDL2 側のバッファ）は
+ *  種類別には分からないので、ヒープ全体の使用量も合わせて表示する。
+ */
+
+#include <string.h>
+#if defined(__GLIBC__) || defined(__EMSCRIPTEN__)
+#include <malloc.h>
+#endif
+
+#include "Memory.h"
+
+
+typedef struct
+{
+	const void*	ptr;				// 確保したもの
+	int			type;				// 種類
+	int			size;				// バイト数
+	char		name[24];			// 名前
+} Entry;
+
+typedef struct
+{
+	long		live;				// 使用中のバイト数
+	long		peak;				// 最大バイト数
+	int			count;				// 使用中の数
+	int			allocs;				// 確保回数
+} Stat;
+
+static Entry*	entry;				// 使用中のもの
+static int		entry_cnt;
+static int		entry_max;			// entry の確保数
+static Stat		mem_stat[MEM_MAX];	// 種類ごとの集計
+static bool		report_flag;		// 結果を表示するか
+
+static int		frame_cnt;			// 集計したフレーム数
+static int		frame_allocs;		// このフレームの確保回数
+static int		frame_max;			// 1フレームの最大確保回数
+static long		total_allocs;		// フレーム中の確保回数の合計
+static long		heap_peak;			// ヒープ使用量の最大
+
+
+/****************************
+    ヒープ使用量
+		戻り値	バイト数（不明なら -1）
+ ****************************/
+static
+long	heap_used(void)
+{
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC_MINOR__ >= 33))
+	return	(long)mallinfo2().uordblks;
+#elif defined(__GLIBC__) || defined(__EMSCRIPTEN__)
+	return	(long)mallinfo().uordblks;
+#else
+	return	-1;
+#endif
+}
+
+
+/**************
+    初期化
+ **************/
+void	init_memory(void)
+{
+	report_flag = (getenv("MEM_REPORT") != NULL);
+	if ( entry ) {
+		pd->system->realloc(entry, 0);
+		entry = NULL;
+	}
+	entry_cnt = 0;
+	entry_max = 0;
+	memset(mem_stat, 0, sizeof(mem_stat));
+	frame_cnt = 0;
+	frame_allocs = 0;
+	frame_max = 0;
+	total_allocs = 0;
+	heap_peak = 0;
+}
+
+/******************************
+    確保を記録
+		引数	_type = 種類
+				_ptr = 確保したもの
+				_size = バイト数
+				_name = 名前
+ ******************************/
+void	track_alloc(int _type, const void* _ptr, int _size, const char* _name)
+{
+	if ( !report_flag || (_ptr == NULL) ) {
+		return;
+	}
+
+	Stat*	_stat = &mem_stat[_type];
+
+	_stat->live += _size;
+	_stat->count++;
+	_stat->allocs++;
+	if ( _stat->live > _stat->peak ) {
+		_stat->peak = _stat->live;
+	}
+	frame_allocs++;
+
+	if ( entry_cnt == entry_max ) {						// 足りなくなったら倍に増やす
+		int		_max = (entry_max > 0) ? entry_max*2 : 128;
+		Entry*	_new = pd->system->realloc(entry, _max*sizeof(Entry));
+
+		if ( _new ) {
+			entry = _new;
+			entry_max = _max;
+		}
+	}
+	if ( entry_cnt < entry_max ) {
+		Entry*	_entry = &entry[entry_cnt++];
+
+		_entry->ptr		= _ptr;
+		_entry->type	= _type;
+		_entry->size	= _size;
+		snprintf(_entry->name, sizeof(_entry->name), "%s", _name);
+	}
+}
+
+/******************************
+    解放を記録
+		引数	_ptr = 解放するもの
+ ******************************/
+void	track_free(const void* _ptr)
+{
+	if ( !report_flag ) {
+		return;
+	}
+	for (int i = entry_cnt - 1; i >= 0; i--) {
+		if ( entry[i].ptr == _ptr ) {
+			Stat*	_stat = &mem_stat[entry[i].type];
+
+			_stat->live -= entry[i].size;
+			_stat->count--;
+			entry[i] = entry[--entry_cnt];
+			return;
+		}
+	}
+}
+
+/******************************************
+    ビットマップ確保を記録
+		引数	_bmp = ビットマップ
+				_name = 名前
+		戻り値	_bmp
+ ******************************************/
+LCDBitmap*	track_bitmap(LCDBitmap* _bmp, const char* _name)
+{
+	if ( report_flag && _bmp ) {
+		int			_w, _h, _rowbytes;
+		uint8_t		*_mask, *_data;
+
+		gfx->getBitmapData(_bmp, &_w, &_h, &_rowbytes, &_mask, &_data);
+		track_alloc(MEM_BITMAP, _bmp, _rowbytes*_h*(_mask ? 2 : 1), _name);
+	}
+	return	_bmp;
+}
+
+/**************************
+    ビットマップ解放
+		引数	_bmp = ビットマップ
+ **************************/
+void	free_bitmap(LCDBitmap* _bmp)
+{
+	track_free(_bmp);
+	gfx->freeBitmap(_bmp);
+}
+
+/******************************************
+    SE データ確保を記録
+		引数	_sample = SE データ
+				_name = 名前
+		戻り値	_sample
+ ******************************************/
+AudioSample*	track_sample(AudioSample* _sample, const char* _name)
+{
+	if ( report_flag && _sample ) {
+		uint8_t*			_data;
+		SoundFormat			_format;
+		uint32_t			_rate, _length = 0;
+
+		if ( pd->sound->sample->getData ) {				// 未対応の環境では大きさ不明
+			pd->sound->sample->getData(_sample, &_data, &_format, &_rate, &_length);
+		}
+		track_alloc(MEM_SAMPLE, _sample, (int)_length, _name);
+	}
+	return	_sample;
+}
+
+/**************************
+    SE データ解放
+		引数	_sample = SE データ
+ **************************/
+void	free_sample(AudioSample* _sample)
+{
+	track_free(_sample);
+	pd->sound->sample->freeSample(_sample);
+}
+
+/********************************
+    フレームごとの集計
+		update_game から毎フレーム呼ぶ
+ ********************************/
+void	frame_memory(void)
+{
+	if ( !report_flag ) {
+		return;
+	}
+	frame_cnt++;
+	total_allocs += frame_allocs;
+	if ( frame_allocs > frame_max ) {
+		frame_max = frame_allocs;
+	}
+	frame_allocs = 0;
+
+	long	_heap = heap_used();
+
+	if ( _heap > heap_peak ) {
+		heap_peak = _heap;
+	}
+}
+
+/****************
+    結果表示
+ ****************/
+void	report_memory(void)
+{
+	static const
+	char*	name[] = {"bitmap", "sample", "player"};
+
+	if ( !report_flag ) {
+		return;
+	}
+	for (int i = 0; i < MEM_MAX; i++) {
+		printf("memory %-7s live=%ldB (%d) peak=%ldB allocs=%d\n", name[i], mem_stat[i].live, mem_stat[i].count, mem_stat[i].peak, mem_stat[i].allocs);
+	}
+	printf("memory frames=%d allocs/frame avg=%.3f max=%d heap=%ldB peak=%ldB\n", frame_cnt,
+			(frame_cnt > 0) ? (double)total_allocs/frame_cnt : 0.0, frame_max, heap_used(), heap_peak);
+
+	for (int i = 0; i < entry_cnt; i++) {					// 解放されていないもの
+		printf("memory leak %-7s %s %dB\n", name[entry[i].type], entry[i].name, entry[i].size);
+	}
+}
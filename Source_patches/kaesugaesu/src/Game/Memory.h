@@ -0,0 +1,27 @@
+﻿#ifndef	___MEMORY_H___
+#define	___MEMORY_H___
+
+#include "App.h"
+
+
+/*** 種類 *******/
+enum
+{
+	MEM_BITMAP,							// ビットマップ
+	MEM_SAMPLE,							// SE データ
+	MEM_PLAYER,							// サウンドプレイヤー
+	MEM_MAX,
+};
+
+
+void		init_memory(void);								// メモリ記録初期化
+void		track_alloc(int, const void*, int, const char*);		// 確保を記録
+void		track_free(const void*);							// 解放を記録
+LCDBitmap*	track_bitmap(LCDBitmap*, const char*);			// ビットマップ確保を記録
+void		free_bitmap(LCDBitmap*);						// ビットマップ解放
+AudioSample*	track_sample(AudioSample*, const char*);	// SE データ確保を記録
+void		free_sample(AudioSample*);						// SE データ解放
+void		frame_memory(void);								// フレームごとの集計
+void		report_memory(void);							// 結果表示
+
+#endif
@@ -0,0 +1,144 @@
+﻿/*
+ *  パネル用ビットマップの再利用
+ *
+ *  パネルのビットマップは Panel.c の init_panel で作られ quit_panel で
+ *  解放されるので、レベルが変わるたびに数十個の確保・解放が起きる。
+ *  begin_pool ～ end_pool の間は gfx の newBitmap・freeBitmap を差し替え、
+ *  解放されたビットマップを大きさごとに取っておいて次の newBitmap で
+ *  消去して返す（長時間動かしたときのヒープの断片化を防ぐ）。
+ *  newBitmap 以外で作られたものや大きさの合わないものは返されないので、
+ *  次のレベルの初期化が済んだら trim_pool で残りを解放する。
+ *  Panel.c には手を入れないので、その中で使う関数（cut_bitmap なども含む）が
+ *  gfx を通していれば何を作っていても再利用される。
+ */
+
+#include "Pool.h"
+
+
+typedef struct
+{
+	LCDBitmap*	bmp;				// ビットマップ
+	int			width, height;		// 大きさ
+	bool		mask;				// マスクがあるか
+} Pooled;
+
+static Pooled*	pool;				// 取ってあるビットマップ
+static int		pool_cnt;
+static int		pool_max;			// pool の確保数
+
+static const struct playdate_graphics*	org_gfx;		// 元の API
+static struct playdate_graphics			pool_gfx;		// 差し替えた API
+
+
+/******************************************
+    ビットマップ作成
+		引数	_w, _h = 大きさ
+				_bg = 背景色
+		戻り値	ビットマップ
+ ******************************************/
+static
+LCDBitmap*	pool_new_bitmap(int _w, int _h, LCDColor _bg)
+{
+	bool	_mask = (_bg == kColorClear);					// 透明で作るものはマスクつき
+
+	for (int i = pool_cnt - 1; i >= 0; i--) {
+		Pooled*	_p = &pool[i];
+
+		if ( (_p->width == _w) && (_p->height == _h) && (_p->mask == _mask) ) {
+			LCDBitmap*	_bmp = _p->bmp;
+
+			*_p = pool[--pool_cnt];
+			org_gfx->clearBitmap(_bmp, _bg);
+			return	_bmp;
+		}
+	}
+	return	org_gfx->newBitmap(_w, _h, _bg);
+}
+
+/******************************************
+    ビットマップ解放（取っておく）
+		引数	_bmp = ビットマップ
+ ******************************************/
+static
+void	pool_free_bitmap(LCDBitmap* _bmp)
+{
+	int			_w, _h, _rowbytes;
+	uint8_t		*_mask, *_data;
+
+	if ( _bmp == NULL ) {
+		return;
+	}
+	if ( pool_cnt == pool_max ) {						// 足りなくなったら倍に増やす
+		int		_max = (pool_max > 0) ? pool_max*2 : 64;
+		Pooled*	_new = pd->system->realloc(pool, _max*sizeof(Pooled));
+
+		if ( _new == NULL ) {
+			org_gfx->freeBitmap(_bmp);
+			return;
+		}
+		pool = _new;
+		pool_max = _max;
+	}
+	org_gfx->getBitmapData(_bmp, &_w, &_h, &_rowbytes, &_mask, &_data);
+
+	Pooled*	_p = &pool[pool_cnt++];
+
+	_p->bmp		= _bmp;
+	_p->width	= _w;
+	_p->height	= _h;
+	_p->mask	= (_mask != NULL);
+}
+
+
+/******************************************
+    ビットマップ再利用開始
+		Panel.c を呼ぶ前に呼ぶ
+ ******************************************/
+void	begin_pool(void)
+{
+	if ( (org_gfx != NULL) || (gfx->clearBitmap == NULL) ) {	// 消去できなければ再利用しない
+		return;
+	}
+	org_gfx = gfx;
+	pool_gfx = *gfx;
+	pool_gfx.newBitmap	= pool_new_bitmap;
+	pool_gfx.freeBitmap	= pool_free_bitmap;
+	gfx = &pool_gfx;
+}
+
+/******************************************
+    ビットマップ再利用終了
+ ******************************************/
+void	end_pool(void)
+{
+	if ( org_gfx == NULL ) {
+		return;
+	}
+	gfx = org_gfx;
+	org_gfx = NULL;
+}
+
+/******************************************
+    使われなかったビットマップ解放
+		パネル初期化の後に呼ぶ
+ ******************************************/
+void	trim_pool(void)
+{
+	for (int i = 0; i < pool_cnt; i++) {
+		gfx->freeBitmap(pool[i].bmp);
+	}
+	pool_cnt = 0;
+}
+
+/******************************************
+    取ってあるビットマップ解放
+ ******************************************/
+void	free_pool(void)
+{
+	trim_pool();
+	if ( pool ) {
+		pd->system->realloc(pool, 0);
+		pool = NULL;
+	}
+	pool_max = 0;
+}
@@ -0,0 +1,12 @@
+﻿#ifndef	___POOL_H___
+#define	___POOL_H___
+
+#include "App.h"
+
+
+void	begin_pool(void);								// ビットマップ再利用開始
+void	end_pool(void);									// ビットマップ再利用終了
+void	trim_pool(void);								// 使われなかったビットマップ解放
+void	free_pool(void);								// 取ってあるビットマップ解放
+
+#endif
@@ -0,0 +1,499 @@
+﻿/*
+ *  API 呼び出しの記録
+ *
+ *  環境変数 TRACE_OUTPUT にファイル名を指定すると、ゲームが呼ぶ gfx・sound・
+ *  file の API を1回ずつ時間とフレーム番号つきで記録し、quit_game で
+ *  Chrome のトレース形式（chrome://tracing や Perfetto で開ける JSON）に書き出す。
+ *  API ごとの呼び出し回数と合計時間も表示する。
+ *
+ *  pd・gfx を記録用の関数に差し替えたコピーに向けるので、App.c からの
+ *  呼び出しも記録される。API の中（SDL2 側）で呼ばれるものは記録されない。
+ *  呼び出しごとに時刻を取るので、同じ実行の BENCH_FRAMES の計測結果は
+ *  その分遅くなる（ベースラインとは比べないこと）。
+ */
+
+#include <string.h>
+
+#include "Trace.h"
+#include "Bench.h"
+
+
+/*** 記録する API *******/
+enum
+{
+	GFX_PUSH_CONTEXT = TRACE_SECTION,
+	GFX_POP_CONTEXT,
+	GFX_CLEAR,
+	GFX_FILL_RECT,
+	GFX_SET_DRAW_MODE,
+	GFX_DRAW_BITMAP,
+	GFX_DRAW_SCALED_BITMAP,
+	GFX_NEW_BITMAP,
+	GFX_FREE_BITMAP,
+	GFX_LOAD_BITMAP,
+	GFX_LOAD_INTO_BITMAP,
+	GFX_COPY_BITMAP,
+	GFX_CLEAR_BITMAP,
+	GFX_GET_BITMAP_DATA,
+	FILEPLAYER_NEW,
+	FILEPLAYER_FREE,
+	FILEPLAYER_LOAD,
+	FILEPLAYER_PLAY,
+	FILEPLAYER_STOP,
+	FILEPLAYER_SET_VOLUME,
+	FILEPLAYER_FADE_VOLUME,
+	SAMPLEPLAYER_NEW,
+	SAMPLEPLAYER_FREE,
+	SAMPLEPLAYER_SET_SAMPLE,
+	SAMPLEPLAYER_PLAY,
+	SAMPLEPLAYER_STOP,
+	SAMPLE_LOAD,
+	SAMPLE_FREE,
+	SAMPLE_GET_DATA,
+	FILE_OPEN,
+	FILE_CLOSE,
+	FILE_READ,
+	TRACE_MAX,
+};
+
+static const
+char*	trace_name[TRACE_MAX] =
+{
+	"update_game",
+	"draw_game",
+	"gfx->pushContext",
+	"gfx->popContext",
+	"gfx->clear",
+	"gfx->fillRect",
+	"gfx->setDrawMode",
+	"gfx->drawBitmap",
+	"gfx->drawScaledBitmap",
+	"gfx->newBitmap",
+	"gfx->freeBitmap",
+	"gfx->loadBitmap",
+	"gfx->loadIntoBitmap",
+	"gfx->copyBitmap",
+	"gfx->clearBitmap",
+	"gfx->getBitmapData",
+	"sound->fileplayer->newPlayer",
+	"sound->fileplayer->freePlayer",
+	"sound->fileplayer->loadIntoPlayer",
+	"sound->fileplayer->play",
+	"sound->fileplayer->stop",
+	"sound->fileplayer->setVolume",
+	"sound->fileplayer->fadeVolume",
+	"sound->sampleplayer->newPlayer",
+	"sound->sampleplayer->freePlayer",
+	"sound->sampleplayer->setSample",
+	"sound->sampleplayer->play",
+	"sound->sampleplayer->stop",
+	"sound->sample->load",
+	"sound->sample->freeSample",
+	"sound->sample->getData",
+	"file->open",
+	"file->close",
+	"file->read",
+};
+
+typedef struct
+{
+	uint64_t	start;				// 開始時刻
+	uint32_t	time;				// 時間
+	uint32_t	frame;				// フレーム
+	int			id;					// API
+} Event;
+
+typedef struct
+{
+	uint64_t	total;				// 合計時間
+	int			count;				// 呼び出し回数
+} Stat;
+
+static const char*	trace_file;		// 書き出し先（NULL = 記録しない）
+static Event*	event;				// 記録
+static int		event_cnt;
+static int		event_max;			// event の確保数
+static Stat		call_stat[TRACE_MAX];	// API ごとの集計
+static uint32_t	frame_cnt;			// フレーム番号
+
+static const PlaydateAPI*					org_pd;		// 元の API
+static const struct playdate_graphics*		org_gfx;
+
+static PlaydateAPI							trace_pd;	// 差し替えた API
+static struct playdate_graphics				trace_gfx;
+static struct playdate_sound				trace_sound;
+static struct playdate_sound_fileplayer		trace_fileplayer;
+static struct playdate_sound_sampleplayer	trace_sampleplayer;
+static struct playdate_sound_sample			trace_sample;
+static struct playdate_file					trace_file_api;
+
+
+/**********************************
+    記録追加
+		引数	_id = API
+				_start = 開始時刻
+ **********************************/
+static
+void	add_event(int _id, uint64_t _start)
+{
+	uint64_t	_t = bench_time() - _start;
+
+	call_stat[_id].total += _t;
+	call_stat[_id].count++;
+
+	if ( event_cnt == event_max ) {						// 足りなくなったら倍に増やす
+		int		_max = (event_max > 0) ? event_max*2 : 4096;
+		Event*	_new = pd->system->realloc(event, _max*sizeof(Event));
+
+		if ( _new == NULL ) {
+			return;
+		}
+		event = _new;
+		event_max = _max;
+	}
+
+	Event*	_e = &event[event_cnt++];
+
+	_e->start	= _start;
+	_e->time	= (_t > UINT32_MAX) ? UINT32_MAX : (uint32_t)_t;
+	_e->frame	= frame_cnt;
+	_e->id		= _id;
+}
+
+// 元の API を呼んで記録する
+#define	CALL(_id, _call)	uint64_t _t = bench_time(); _call; add_event(_id, _t)
+
+// 関数を差し替える（API 側にない関数はそのまま）
+#define	WRAP(_func, _wrap)	if ( _func ) _func = _wrap
+
+
+/*** gfx *******/
+static void			gfx_push_context(LCDBitmap* _bmp)						{ CALL(GFX_PUSH_CONTEXT, org_gfx->pushContext(_bmp)); }
+static void			gfx_pop_context(void)									{ CALL(GFX_POP_CONTEXT, org_gfx->popContext()); }
+static void			gfx_clear(LCDColor _c)									{ CALL(GFX_CLEAR, org_gfx->clear(_c)); }
+static void			gfx_fill_rect(int _x, int _y, int _w, int _h, LCDColor _c)	{ CALL(GFX_FILL_RECT, org_gfx->fillRect(_x, _y, _w, _h, _c)); }
+static void			gfx_draw_bitmap(LCDBitmap* _bmp, int _x, int _y, LCDBitmapFlip _flip)	{ CALL(GFX_DRAW_BITMAP, org_gfx->drawBitmap(_bmp, _x, _y, _flip)); }
+static void			gfx_draw_scaled_bitmap(LCDBitmap* _bmp, int _x, int _y, float _sx, float _sy)	{ CALL(GFX_DRAW_SCALED_BITMAP, org_gfx->drawScaledBitmap(_bmp, _x, _y, _sx, _sy)); }
+static void			gfx_free_bitmap(LCDBitmap* _bmp)						{ CALL(GFX_FREE_BITMAP, org_gfx->freeBitmap(_bmp)); }
+static void			gfx_load_into_bitmap(const char* _path, LCDBitmap* _bmp, const char** _err)	{ CALL(GFX_LOAD_INTO_BITMAP, org_gfx->loadIntoBitmap(_path, _bmp, _err)); }
+static void			gfx_clear_bitmap(LCDBitmap* _bmp, LCDColor _c)			{ CALL(GFX_CLEAR_BITMAP, org_gfx->clearBitmap(_bmp, _c)); }
+static void			gfx_get_bitmap_data(LCDBitmap* _bmp, int* _w, int* _h, int* _rowbytes, uint8_t** _mask, uint8_t** _data)	{ CALL(GFX_GET_BITMAP_DATA, org_gfx->getBitmapData(_bmp, _w, _h, _rowbytes, _mask, _data)); }
+
+static
+LCDBitmapDrawMode	gfx_set_draw_mode(LCDBitmapDrawMode _mode)
+{
+	LCDBitmapDrawMode	_r;
+
+	CALL(GFX_SET_DRAW_MODE, _r = org_gfx->setDrawMode(_mode));
+	return	_r;
+}
+
+static
+LCDBitmap*	gfx_new_bitmap(int _w, int _h, LCDColor _c)
+{
+	LCDBitmap*	_r;
+
+	CALL(GFX_NEW_BITMAP, _r = org_gfx->newBitmap(_w, _h, _c));
+	return	_r;
+}
+
+static
+LCDBitmap*	gfx_load_bitmap(const char* _path, const char** _err)
+{
+	LCDBitmap*	_r;
+
+	CALL(GFX_LOAD_BITMAP, _r = org_gfx->loadBitmap(_path, _err));
+	return	_r;
+}
+
+static
+LCDBitmap*	gfx_copy_bitmap(LCDBitmap* _bmp)
+{
+	LCDBitmap*	_r;
+
+	CALL(GFX_COPY_BITMAP, _r = org_gfx->copyBitmap(_bmp));
+	return	_r;
+}
+
+
+/*** fileplayer *******/
+static void			fileplayer_free(FilePlayer* _p)						{ CALL(FILEPLAYER_FREE, org_pd->sound->fileplayer->freePlayer(_p)); }
+static void			fileplayer_stop(FilePlayer* _p)						{ CALL(FILEPLAYER_STOP, org_pd->sound->fileplayer->stop(_p)); }
+static void			fileplayer_set_volume(FilePlayer* _p, float _l, float _r)	{ CALL(FILEPLAYER_SET_VOLUME, org_pd->sound->fileplayer->setVolume(_p, _l, _r)); }
+static void			fileplayer_fade_volume(FilePlayer* _p, float _l, float _r, int32_t _len, sndCallbackProc* _cb, void* _data)	{ CALL(FILEPLAYER_FADE_VOLUME, org_pd->sound->fileplayer->fadeVolume(_p, _l, _r, _len, _cb, _data)); }
+
+static
+FilePlayer*	fileplayer_new(void)
+{
+	FilePlayer*	_r;
+
+	CALL(FILEPLAYER_NEW, _r = org_pd->sound->fileplayer->newPlayer());
+	return	_r;
+}
+
+static
+int		fileplayer_load(FilePlayer* _p, const char* _path)
+{
+	int		_r;
+
+	CALL(FILEPLAYER_LOAD, _r = org_pd->sound->fileplayer->loadIntoPlayer(_p, _path));
+	return	_r;
+}
+
+static
+int		fileplayer_play(FilePlayer* _p, int _repeat)
+{
+	int		_r;
+
+	CALL(FILEPLAYER_PLAY, _r = org_pd->sound->fileplayer->play(_p, _repeat));
+	return	_r;
+}
+
+
+/*** sampleplayer *******/
+static void			sampleplayer_free(SamplePlayer* _p)					{ CALL(SAMPLEPLAYER_FREE, org_pd->sound->sampleplayer->freePlayer(_p)); }
+static void			sampleplayer_set_sample(SamplePlayer* _p, AudioSample* _s)	{ CALL(SAMPLEPLAYER_SET_SAMPLE, org_pd->sound->sampleplayer->setSample(_p, _s)); }
+static void			sampleplayer_stop(SamplePlayer* _p)					{ CALL(SAMPLEPLAYER_STOP, org_pd->sound->sampleplayer->stop(_p)); }
+
+static
+SamplePlayer*	sampleplayer_new(void)
+{
+	SamplePlayer*	_r;
+
+	CALL(SAMPLEPLAYER_NEW, _r = org_pd->sound->sampleplayer->newPlayer());
+	return	_r;
+}
+
+static
+int		sampleplayer_play(SamplePlayer* _p, int _repeat, float _rate)
+{
+	int		_r;
+
+	CALL(SAMPLEPLAYER_PLAY, _r = org_pd->sound->sampleplayer->play(_p, _repeat, _rate));
+	return	_r;
+}
+
+
+/*** sample *******/
+static void			sample_free(AudioSample* _s)						{ CALL(SAMPLE_FREE, org_pd->sound->sample->freeSample(_s)); }
+static void			sample_get_data(AudioSample* _s, uint8_t** _data, SoundFormat* _format, uint32_t* _rate, uint32_t* _len)	{ CALL(SAMPLE_GET_DATA, org_pd->sound->sample->getData(_s, _data, _format, _rate, _len)); }
+
+static
+AudioSample*	sample_load(const char* _path)
+{
+	AudioSample*	_r;
+
+	CALL(SAMPLE_LOAD, _r = org_pd->sound->sample->load(_path));
+	return	_r;
+}
+
+
+/*** file *******/
+static
+SDFile*	file_open(const char* _path, FileOptions _mode)
+{
+	SDFile*		_r;
+
+	CALL(FILE_OPEN, _r = org_pd->file->open(_path, _mode));
+	return	_r;
+}
+
+static
+int		file_close(SDFile* _fp)
+{
+	int		_r;
+
+	CALL(FILE_CLOSE, _r = org_pd->file->close(_fp));
+	return	_r;
+}
+
+static
+int		file_read(SDFile* _fp, void* _buf, unsigned int _len)
+{
+	int		_r;
+
+	CALL(FILE_READ, _r = org_pd->file->read(_fp, _buf, _len));
+	return	_r;
+}
+
+
+/**************
+    初期化
+ **************/
+void	init_trace(void)
+{
+	const char*	_env = getenv("TRACE_OUTPUT");
+
+	if ( (_env == NULL) || (*_env == '\0') || trace_file ) {
+		return;
+	}
+	trace_file = _env;
+	event_cnt = 0;
+	frame_cnt = 0;
+	memset(call_stat, 0, sizeof(call_stat));
+
+	org_pd	= pd;
+	org_gfx	= gfx;
+
+	trace_gfx = *gfx;									// 元の API をコピーして記録するものだけ差し替える
+	WRAP(trace_gfx.pushContext,			gfx_push_context);
+	WRAP(trace_gfx.popContext,			gfx_pop_context);
+	WRAP(trace_gfx.clear,				gfx_clear);
+	WRAP(trace_gfx.fillRect,			gfx_fill_rect);
+	WRAP(trace_gfx.setDrawMode,			gfx_set_draw_mode);
+	WRAP(trace_gfx.drawBitmap,			gfx_draw_bitmap);
+	WRAP(trace_gfx.drawScaledBitmap,	gfx_draw_scaled_bitmap);
+	WRAP(trace_gfx.newBitmap,			gfx_new_bitmap);
+	WRAP(trace_gfx.freeBitmap,			gfx_free_bitmap);
+	WRAP(trace_gfx.loadBitmap,			gfx_load_bitmap);
+	WRAP(trace_gfx.loadIntoBitmap,		gfx_load_into_bitmap);
+	WRAP(trace_gfx.copyBitmap,			gfx_copy_bitmap);
+	WRAP(trace_gfx.clearBitmap,			gfx_clear_bitmap);
+	WRAP(trace_gfx.getBitmapData,		gfx_get_bitmap_data);
+
+	trace_fileplayer = *pd->sound->fileplayer;
+	WRAP(trace_fileplayer.newPlayer,		fileplayer_new);
+	WRAP(trace_fileplayer.freePlayer,		fileplayer_free);
+	WRAP(trace_fileplayer.loadIntoPlayer,	fileplayer_load);
+	WRAP(trace_fileplayer.play,				fileplayer_play);
+	WRAP(trace_fileplayer.stop,				fileplayer_stop);
+	WRAP(trace_fileplayer.setVolume,		fileplayer_set_volume);
+	WRAP(trace_fileplayer.fadeVolume,		fileplayer_fade_volume);
+
+	trace_sampleplayer = *pd->sound->sampleplayer;
+	WRAP(trace_sampleplayer.newPlayer,	sampleplayer_new);
+	WRAP(trace_sampleplayer.freePlayer,	sampleplayer_free);
+	WRAP(trace_sampleplayer.setSample,	sampleplayer_set_sample);
+	WRAP(trace_sampleplayer.play,		sampleplayer_play);
+	WRAP(trace_sampleplayer.stop,		sampleplayer_stop);
+
+	trace_sample = *pd->sound->sample;
+	WRAP(trace_sample.load,			sample_load);
+	WRAP(trace_sample.freeSample,	sample_free);
+	WRAP(trace_sample.getData,		sample_get_data);
+
+	trace_sound = *pd->sound;
+	trace_sound.fileplayer		= &trace_fileplayer;
+	trace_sound.sampleplayer	= &trace_sampleplayer;
+	trace_sound.sample			= &trace_sample;
+
+	trace_file_api = *pd->file;
+	WRAP(trace_file_api.open,	file_open);
+	WRAP(trace_file_api.close,	file_close);
+	WRAP(trace_file_api.read,	file_read);
+
+	trace_pd = *pd;
+	trace_pd.graphics	= &trace_gfx;
+	trace_pd.sound		= &trace_sound;
+	trace_pd.file		= &trace_file_api;
+
+	pd	= &trace_pd;
+	gfx	= &trace_gfx;
+}
+
+/******************************
+    回数・時間比較（qsort 用）
+ ******************************/
+static
+int		compare_stat(const void* _a, const void* _b)
+{
+	uint64_t	_x = call_stat[*(const int*)_a].total, _y = call_stat[*(const int*)_b].total;
+
+	return	(_x < _y) - (_x > _y);
+}
+
+/**********************************
+    記録書き出し・終了
+ **********************************/
+void	quit_trace(void)
+{
+	if ( trace_file == NULL ) {
+		return;
+	}
+	pd	= org_pd;										// 元の API に戻す
+	gfx	= org_gfx;
+
+	FILE*	_fp = fopen(trace_file, "w");
+
+	if ( _fp ) {
+		uint64_t	_base = (event_cnt > 0) ? event[0].start : 0;
+
+		for (int i = 1; i < event_cnt; i++) {			// 区間は中の呼び出しより後に記録されている
+			if ( event[i].start < _base ) {
+				_base = event[i].start;
+			}
+		}
+		fprintf(_fp, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+		for (int i = 0; i < event_cnt; i++) {
+			Event*		_e = &event[i];
+			const char*	_name = trace_name[_e->id];
+			char		_cat[16] = "game";					// 分類（"gfx->fillRect" なら "gfx"）
+
+			if ( _e->id >= TRACE_SECTION ) {
+				snprintf(_cat, sizeof(_cat), "%.*s", (int)(strchr(_name, '-') - _name), _name);
+			}
+			fprintf(_fp, "%s{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": 1, \"args\": {\"frame\": %u}}",
+					(i > 0) ? ",\n" : "", _name, _cat, (_e->start - _base)/1000.0, _e->time/1000.0, _e->frame);
+		}
+		fprintf(_fp, "\n]}\n");
+		fclose(_fp);
+		printf("trace %d calls in %u frames written to %s\n", event_cnt, frame_cnt, trace_file);
+	}
+	else {
+		printf("trace: cannot open %s\n", trace_file);
+	}
+
+	int		_order[TRACE_MAX];
+
+	for (int i = 0; i < TRACE_MAX; i++) {
+		_order[i] = i;
+	}
+	qsort(_order, TRACE_MAX, sizeof(int), compare_stat);
+	for (int i = 0; i < TRACE_MAX; i++) {				// 合計時間の長い順
+		Stat*	_s = &call_stat[_order[i]];
+
+		if ( (_s->count == 0) || (_order[i] < TRACE_SECTION) ) {
+			continue;
+		}
+		printf("trace %-34s count=%-8d per frame=%-8.1f total=%.3fms avg=%.3fus\n", trace_name[_order[i]], _s->count,
+				(frame_cnt > 0) ? (double)_s->count/frame_cnt : 0.0, _s->total/1000000.0, _s->total/1000.0/_s->count);
+	}
+	fflush(stdout);
+
+	if ( event ) {
+		pd->system->realloc(event, 0);
+		event = NULL;
+	}
+	event_cnt = 0;
+	event_max = 0;
+	trace_file = NULL;
+}
+
+/**************************
+    フレーム開始
+ **************************/
+void	frame_trace(void)
+{
+	frame_cnt++;
+}
+
+/**************************
+    区間開始
+		戻り値	開始時刻
+ **************************/
+uint64_t	begin_trace(void)
+{
+	return	(trace_file != NULL) ? bench_time() : 0;
+}
+
+/**************************
+    区間終了
+		引数	_n = 記録区間
+				_start = 開始時刻
+ **************************/
+void	end_trace(int _n, uint64_t _start)
+{
+	if ( trace_file != NULL ) {
+		add_event(_n, _start);
+	}
+}
@@ -0,0 +1,24 @@
+﻿#ifndef	___TRACE_H___
+#define	___TRACE_H___
+
+#include <stdint.h>
+
+#include "App.h"
+
+
+/*** 記録区間 *******/
+enum
+{
+	TRACE_UPDATE,						// update_game
+	TRACE_DRAW,							// draw_game
+	TRACE_SECTION,
+};
+
+
+void		init_trace(void);							// API 呼び出し記録初期化
+void		quit_trace(void);							// 記録書き出し・終了
+void		frame_trace(void);							// フレーム開始
+uint64_t	begin_trace(void);							// 区間開始
+void		end_trace(int, uint64_t);					// 区間終了
+
+#endif
@@ -0,0 +1,532 @@
+
+/*
+ *  かえすがえす 問題数え上げ
+ *
+ *  Game.c の規則で作られる問題をすべて数え上げる。
+ *    問題 = 出発点 + 裏返っているパネルの組（パネルの表裏 = 周囲4本のラインの XOR）
+ *    解   = 出発点から始まる単純な経路（同じ点を2度通らない）で、その組を作るもの
+ *           （途中で一度その組になった経路はそこでクリアになるので数えない）
+ *  盤面の対称性（回転・反転の8通り）で出発点を代表点に絞り、
+ *  探索木を全コアに work stealing で分配する。
+ *
+ *  make kaesugaesu_enum（make check で 2x2・3x3 の結果を kaesugaesu_enum.expected と比べる）
+ *  ./kaesugaesu_enum [-t スレッド数] [-o 一覧ファイル] サイズ...（2〜5、省略時 3 4）
+ *
+ *  一覧ファイルには対称性で重複を除いた問題を1行ずつ
+ *  "番号 サイズ 出発点x 出発点y パネル(16進) 解の数" で出力する。
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#define	FIELD_MAX	5					// 最大サイズ（パネルの組 2^25）
+#define	VERTEX_MAX	((FIELD_MAX + 1)*(FIELD_MAX + 1))
+#define	SPLIT_DEPTH	8					// この深さまではタスクに分けて配る
+#define	THREAD_MAX	256
+#define	HIST_MAX	32					// 解の数の分布（2の累乗ごと）
+
+
+/****************
+    探索タスク
+ ****************/
+typedef struct
+{
+	uint64_t	visited;			// 通過済みの点
+	uint32_t	mask;				// 裏返っているパネル
+	int			pos;				// 現在の点
+	int			depth;				// 経路の長さ
+	uint32_t	history[SPLIT_DEPTH + 1];	// 途中の各点でのパネルの組
+} Task;
+
+/********************************
+    タスク置き場（スレッドごと）
+ ********************************/
+typedef struct
+{
+	pthread_mutex_t	lock;
+	Task*			task;
+	int				head;			// 盗まれる側（古い＝大きい部分木）
+	int				tail;			// 自分で積む・取る側
+	int				size;
+} Deque;
+
+/******************
+    ワーカー
+ ******************/
+typedef struct
+{
+	pthread_t	thread;
+	int			id;
+	Deque		deque;
+	uint64_t	paths;				// 数えた経路数
+	uint32_t	history[VERTEX_MAX];	// 探索中の経路の各点でのパネルの組
+} Worker;
+
+
+static int			field;								// パネルの数（1辺）
+static int			vertex_w;							// 点の数（1辺）
+static int			next_v[VERTEX_MAX][4];				// 移動先（-1 = なし）
+static uint32_t		flip[VERTEX_MAX][4];				// 移動で裏返るパネル
+
+static int			perm_v[8][VERTEX_MAX];				// 対称変換（点）
+static uint32_t		perm_tbl[8][4][256];				// 対称変換（パネルの組、1バイトずつ）
+
+static atomic_uint*	count;								// パネルの組ごとの解の数
+static atomic_long	pending;							// 未処理のタスク数
+
+static Worker		worker[THREAD_MAX];
+static int			thread_num;
+
+
+/**************************************
+    対称変換
+		引数	_g = 変換番号（0〜7）
+				_x, _y = 座標
+				_w = 1辺の数
+		戻り値	変換後の番号
+ **************************************/
+static
+int		transform(int _g, int _x, int _y, int _w)
+{
+	if ( _g & 4 ) {
+		int		_t = _x;
+		_x = _y;
+		_y = _t;
+	}
+	if ( _g & 1 ) {
+		_x = _w - 1 - _x;
+	}
+	if ( _g & 2 ) {
+		_y = _w - 1 - _y;
+	}
+	return	_y*_w + _x;
+}
+
+/******************************
+    盤面の情報作成
+		引数	_field = サイズ
+ ******************************/
+static
+void	init_field(int _field)
+{
+	static const
+	int		dir[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+	field = _field;
+	vertex_w = _field + 1;
+
+	for (int y = 0; y < vertex_w; y++) {
+		for (int x = 0; x < vertex_w; x++) {
+			int		_v = y*vertex_w + x;
+
+			for (int d = 0; d < 4; d++) {
+				int		_x = x + dir[d][0], _y = y + dir[d][1];
+
+				next_v[_v][d] = -1;
+				flip[_v][d] = 0;
+				if ( (_x < 0) || (_x >= vertex_w) || (_y < 0) || (_y >= vertex_w) ) {
+					continue;
+				}
+				next_v[_v][d] = _y*vertex_w + _x;
+				if ( d < 2 ) {							// 横ライン：上下のパネル
+					int		_px = (_x < x) ? _x : x;
+					if ( y > 0 ) {
+						flip[_v][d] |= 1u << ((y - 1)*field + _px);
+					}
+					if ( y < field ) {
+						flip[_v][d] |= 1u << (y*field + _px);
+					}
+				}
+				else {									// 縦ライン：左右のパネル
+					int		_py = (_y < y) ? _y : y;
+					if ( x > 0 ) {
+						flip[_v][d] |= 1u << (_py*field + x - 1);
+					}
+					if ( x < field ) {
+						flip[_v][d] |= 1u << (_py*field + x);
+					}
+				}
+			}
+		}
+	}
+
+	for (int g = 0; g < 8; g++) {
+		for (int y = 0; y < vertex_w; y++) {
+			for (int x = 0; x < vertex_w; x++) {
+				perm_v[g][y*vertex_w + x] = transform(g, x, y, vertex_w);
+			}
+		}
+		memset(perm_tbl[g], 0, sizeof(perm_tbl[g]));
+		for (int k = 0; k < 4; k++) {
+			for (int b = 0; b < 256; b++) {
+				for (int i = 0; i < 8; i++) {
+					int		_n = k*8 + i;
+
+					if ( (b & (1 << i)) && (_n < field*field) ) {
+						perm_tbl[g][k][b] |= 1u << transform(g, _n % field, _n / field, field);
+					}
+				}
+			}
+		}
+	}
+}
+
+/**************************************
+    パネルの組の対称変換
+ **************************************/
+static
+uint32_t	transform_mask(int _g, uint32_t _m)
+{
+	return	perm_tbl[_g][0][_m & 0xff] | perm_tbl[_g][1][(_m >> 8) & 0xff]
+				| perm_tbl[_g][2][(_m >> 16) & 0xff] | perm_tbl[_g][3][_m >> 24];
+}
+
+
+/**************************
+    タスクを積む
+ **************************/
+static
+void	push_task(Worker* _w, const Task* _t)
+{
+	Deque*	_d = &_w->deque;
+
+	atomic_fetch_add(&pending, 1);
+	pthread_mutex_lock(&_d->lock);
+	if ( _d->tail == _d->size ) {
+		if ( _d->head > 0 ) {							// 前を詰める
+			memmove(_d->task, _d->task + _d->head, (_d->tail - _d->head)*sizeof(Task));
+			_d->tail -= _d->head;
+			_d->head = 0;
+		}
+		else {
+			_d->size = (_d->size > 0) ? _d->size*2 : 1024;
+			_d->task = realloc(_d->task, _d->size*sizeof(Task));
+			if ( _d->task == NULL ) {
+				fprintf(stderr, "out of memory\n");
+				exit(1);
+			}
+		}
+	}
+	_d->task[_d->tail++] = *_t;
+	pthread_mutex_unlock(&_d->lock);
+}
+
+/******************************************
+    タスクを取る
+		引数	_d = タスク置き場
+				_t = 取ったタスク
+				_steal = 他のスレッドから盗むか
+		戻り値	取れたか
+ ******************************************/
+static
+bool	pop_task(Deque* _d, Task* _t, bool _steal)
+{
+	bool	_ok = false;
+
+	pthread_mutex_lock(&_d->lock);
+	if ( _d->head < _d->tail ) {
+		*_t = _steal ? _d->task[_d->head++] : _d->task[--_d->tail];
+		if ( _d->head == _d->tail ) {
+			_d->head = _d->tail = 0;
+		}
+		_ok = true;
+	}
+	pthread_mutex_unlock(&_d->lock);
+	return	_ok;
+}
+
+/**********************************
+    経路探索
+		引数	_w = ワーカー
+				_t = 探索する経路（_w->history に途中の組が入っていること）
+ **********************************/
+static
+void	search(Worker* _w, const Task* _t)
+{
+	for (int d = 0; d < 4; d++) {
+		int		_n = next_v[_t->pos][d];
+
+		if ( (_n < 0) || (_t->visited & (1ull << _n)) ) {
+			continue;
+		}
+
+		Task	_next;
+		bool	_first = true;
+
+		_next.visited = _t->visited | (1ull << _n);
+		_next.mask = _t->mask ^ flip[_t->pos][d];
+		_next.pos = _n;
+		_next.depth = _t->depth + 1;
+
+		for (int i = 0; (i <= _t->depth) && _first; i++) {	// 途中で同じ組になっていれば
+			_first = (_w->history[i] != _next.mask);		// そこでクリアなので解ではない
+		}
+		if ( _first ) {
+			atomic_fetch_add_explicit(&count[_next.mask], 1, memory_order_relaxed);
+		}
+		_w->paths++;
+		_w->history[_next.depth] = _next.mask;
+
+		if ( _next.depth < SPLIT_DEPTH ) {				// 浅いところは他のスレッドにも配る
+			memcpy(_next.history, _w->history, (_next.depth + 1)*sizeof(uint32_t));
+			push_task(_w, &_next);
+		}
+		else {
+			search(_w, &_next);
+		}
+	}
+}
+
+/**************************
+    ワーカースレッド
+ **************************/
+static
+void*	run_worker(void* _arg)
+{
+	Worker*	_w = _arg;
+	Task	_t;
+
+	for (;;) {
+		bool	_ok = pop_task(&_w->deque, &_t, false);
+
+		for (int i = 1; !_ok && (i < thread_num); i++) {		// 他から盗む
+			_ok = pop_task(&worker[(_w->id + i) % thread_num].deque, &_t, true);
+		}
+		if ( _ok ) {
+			memcpy(_w->history, _t.history, (_t.depth + 1)*sizeof(uint32_t));
+			search(_w, &_t);
+			atomic_fetch_sub(&pending, 1);
+		}
+		else if ( atomic_load(&pending) == 0 ) {
+			break;
+		}
+		else {
+			sched_yield();
+		}
+	}
+	return	NULL;
+}
+
+/******************************************
+    出発点から全経路を数える
+		引数	_start = 出発点
+		戻り値	経路数
+ ******************************************/
+static
+uint64_t	count_paths(int _start)
+{
+	Task		_t = {1ull << _start, 0, _start, 0, {0}};
+	uint64_t	_paths = 0;
+
+	memset(count, 0, sizeof(atomic_uint) << (field*field));
+	atomic_store(&pending, 0);
+	for (int i = 0; i < thread_num; i++) {
+		worker[i].paths = 0;
+	}
+	push_task(&worker[0], &_t);
+
+	for (int i = 0; i < thread_num; i++) {
+		pthread_create(&worker[i].thread, NULL, run_worker, &worker[i]);
+	}
+	for (int i = 0; i < thread_num; i++) {
+		pthread_join(worker[i].thread, NULL);
+		_paths += worker[i].paths;
+	}
+	return	_paths;
+}
+
+
+/**************************
+    分布の区分
+ **************************/
+static
+int		hist_index(unsigned _n)
+{
+	int		_i = 0;
+
+	while ( (_n >>= 1) != 0 ) {
+		_i++;
+	}
+	return	(_i < HIST_MAX) ? _i : HIST_MAX - 1;
+}
+
+/******************************************
+    1サイズ分の数え上げ
+		引数	_field = サイズ
+				_fp = 一覧ファイル（NULL = 出力しない）
+				_index = 一覧の通し番号
+ ******************************************/
+static
+void	enumerate(int _field, FILE* _fp, uint64_t* _index)
+{
+	uint64_t	_paths = 0, _puzzles = 0, _unique = 0;
+	uint64_t	_hist[HIST_MAX] = {0}, _hist_u[HIST_MAX] = {0};
+	uint64_t	_one = 0, _one_u = 0;
+	unsigned	_max = 0;
+	int			_reps = 0;
+
+	init_field(_field);
+	count = malloc(sizeof(atomic_uint) << (field*field));
+	if ( count == NULL ) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	for (int s = 0; s < vertex_w*vertex_w; s++) {
+		int		_orbit[8], _orbit_n = 0, _stab[8], _stab_n = 0;
+		bool	_rep = true;
+
+		for (int g = 0; g < 8; g++) {					// 代表点（軌道の中で一番小さい番号）か
+			int		_v = perm_v[g][s];
+
+			if ( _v < s ) {
+				_rep = false;
+			}
+			if ( _v == s ) {
+				_stab[_stab_n++] = g;
+			}
+			bool	_found = false;
+			for (int i = 0; i < _orbit_n; i++) {
+				_found |= (_orbit[i] == _v);
+			}
+			if ( !_found ) {
+				_orbit[_orbit_n++] = _v;
+			}
+		}
+		if ( !_rep ) {
+			continue;
+		}
+		_reps++;
+
+		_paths += count_paths(s)*_orbit_n;				// 対称な出発点の分も足す
+
+		for (uint32_t m = 1; m < (1u << (field*field)); m++) {
+			unsigned	_n = atomic_load_explicit(&count[m], memory_order_relaxed);
+
+			if ( _n == 0 ) {
+				continue;
+			}
+			_puzzles += _orbit_n;
+			_hist[hist_index(_n)] += _orbit_n;
+			if ( _n == 1 ) {
+				_one += _orbit_n;
+			}
+			if ( _n > _max ) {
+				_max = _n;
+			}
+
+			bool	_canon = true;						// 出発点を動かさない変換の中で最小か
+			for (int i = 0; (i < _stab_n) && _canon; i++) {
+				_canon = (transform_mask(_stab[i], m) >= m);
+			}
+			if ( !_canon ) {
+				continue;
+			}
+			_unique++;
+			_hist_u[hist_index(_n)]++;
+			if ( _n == 1 ) {
+				_one_u++;
+			}
+			if ( _fp ) {
+				fprintf(_fp, "%llu %d %d %d %0*x %u\n", (unsigned long long)(*_index)++, field,
+							s % vertex_w, s / vertex_w, (field*field + 3)/4, m, _n);
+			}
+		}
+	}
+	free(count);
+
+	printf("size %dx%d: starts %d (%d up to symmetry), paths %llu\n", field, field, vertex_w*vertex_w, _reps, (unsigned long long)_paths);
+	printf("  puzzles %llu, up to symmetry %llu\n", (unsigned long long)_puzzles, (unsigned long long)_unique);
+	printf("  unique solution %llu (%.2f%%), up to symmetry %llu, most solutions %u\n",
+			(unsigned long long)_one, _puzzles ? _one*100.0/_puzzles : 0.0, (unsigned long long)_one_u, _max);
+	printf("  %-14s %14s %14s\n", "solutions", "puzzles", "up to sym.");
+	for (int i = 0; i < HIST_MAX; i++) {
+		char	_range[32];
+
+		if ( _hist[i] == 0 ) {
+			continue;
+		}
+		if ( i == 0 ) {
+			snprintf(_range, sizeof(_range), "1");
+		}
+		else {
+			snprintf(_range, sizeof(_range), "%u-%u", 1u << i, (2u << i) - 1);
+		}
+		printf("  %-14s %14llu %14llu\n", _range, (unsigned long long)_hist[i], (unsigned long long)_hist_u[i]);
+	}
+	fflush(stdout);
+}
+
+/**********
+    main
+ **********/
+int		main(int _argc, char** _argv)
+{
+	const char*	_file = NULL;
+	int			_sizes[8], _size_n = 0;
+	int			_opt;
+
+	thread_num = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	while ( (_opt = getopt(_argc, _argv, "t:o:h")) != -1 ) {
+		switch ( _opt ) {
+		  case 't' :
+			thread_num = atoi(optarg);
+			break;
+		  case 'o' :
+			_file = optarg;
+			break;
+		  default :
+			fprintf(stderr, "usage: %s [-t threads] [-o index file] size...\n", _argv[0]);
+			return	1;
+		}
+	}
+	if ( thread_num < 1 ) {
+		thread_num = 1;
+	}
+	if ( thread_num > THREAD_MAX ) {
+		thread_num = THREAD_MAX;
+	}
+	for (int i = optind; (i < _argc) && (_size_n < 8); i++) {
+		_sizes[_size_n] = atoi(_argv[i]);
+		if ( (_sizes[_size_n] < 2) || (_sizes[_size_n] > FIELD_MAX) ) {
+			fprintf(stderr, "size must be 2 to %d\n", FIELD_MAX);
+			return	1;
+		}
+		_size_n++;
+	}
+	if ( _size_n == 0 ) {
+		_sizes[_size_n++] = 3;
+		_sizes[_size_n++] = 4;
+	}
+
+	FILE*	_fp = NULL;
+
+	if ( _file && ((_fp = fopen(_file, "w")) == NULL) ) {
+		fprintf(stderr, "cannot open %s\n", _file);
+		return	1;
+	}
+	for (int i = 0; i < thread_num; i++) {
+		worker[i].id = i;
+		pthread_mutex_init(&worker[i].deque.lock, NULL);
+	}
+
+	uint64_t	_index = 0;
+
+	printf("threads %d\n", thread_num);
+	for (int i = 0; i < _size_n; i++) {
+		enumerate(_sizes[i], _fp, &_index);
+	}
+
+	if ( _fp ) {
+		fclose(_fp);
+	}
+	return	0;
+}